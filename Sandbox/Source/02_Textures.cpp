@@ -66,7 +66,7 @@ int main() {
   auto vertexShader = xlux::CreateRawPtr<HelloWorldVShader>();
   auto fragmentShader = xlux::CreateRawPtr<HelloWorldFShader>();
   auto interpolator =
-      xlux::CreateRawPtr<xlux::BasicInterpolator<VertexOutData>>();
+      xlux::CreateRawPtr<xlux::LinearInterpolator<VertexOutData>>();
 
   auto createInfo = xlux::PipelineCreateInfo()
                         .SetShader(vertexShader, xlux::ShaderStage_Vertex)
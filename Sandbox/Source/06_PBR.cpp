@@ -383,18 +383,16 @@ int main() {
   auto vertexShader = xlux::CreateRawPtr<HelloWorldVShader>();
   auto fragmentShader = xlux::CreateRawPtr<HelloWorldFShader>();
   auto interpolator =
-      xlux::CreateRawPtr<xlux::BasicInterpolator<VertexOutData>>();
-
-  auto createInfo = xlux::PipelineCreateInfo()
-                        .SetShader(vertexShader, xlux::ShaderStage_Vertex)
-                        .SetShader(fragmentShader, xlux::ShaderStage_Fragment)
-                        .SetInterpolator(interpolator)
-                        .SetDepthTestEnable(true)
-                        .SetClippingEnable(true)
-                        .SetBackfaceCullingEnable(true)
-                        .SetDepthCompareFunction(xlux::CompareFunction_Less)
-                        .SetVertexItemSize(sizeof(VertexInData))
-                        .SetVertexToFragmentDataSize(sizeof(VertexOutData));
+      xlux::CreateRawPtr<xlux::LinearInterpolator<VertexOutData>>();
+
+  auto createInfo =
+      xlux::TypedPipelineCreateInfo<VertexInData, VertexOutData,
+                                    HelloWorldVShader, HelloWorldFShader>(
+          vertexShader, fragmentShader, interpolator)
+          .SetDepthTestEnable(true)
+          .SetClippingEnable(true)
+          .SetBackfaceCullingEnable(true)
+          .SetDepthCompareFunction(xlux::CompareFunction_Less);
 
   auto pipeline = device->CreatePipeline(createInfo);
 
@@ -50,7 +50,7 @@ void WindowFramebuffer::GetDepthPixel(xlux::I32 x, xlux::I32 y,
   depth = s_DepthBuffer[x][y];
 }
 
-void WindowFramebuffer::SetDepthPixel(xlux::I32 x, xlux::I32 y,
-                                      xlux::F32 depth) {
+void WindowFramebuffer::WriteDepthPixel(xlux::I32 x, xlux::I32 y,
+                                        xlux::F32 depth) {
   s_DepthBuffer[x][y] = depth;
 }
\ No newline at end of file
@@ -385,7 +385,7 @@ bool ImGui_ImplXlux_CreateDeviceObjects() {
           .SetShader(bd->XluxFragmentShader, xlux::ShaderStage_Fragment)
           .SetInterpolator(
               xlux::CreateRawPtr<
-                  xlux::BasicInterpolator<ImGui_ImplXlux_VertexOutData>>())
+                  xlux::LinearInterpolator<ImGui_ImplXlux_VertexOutData>>())
           .SetVertexItemSize(sizeof(ImGui_ImplXlux_VertexInData))
           .SetVertexToFragmentDataSize(sizeof(ImGui_ImplXlux_VertexOutData))
           .SetBlendEnable(true)
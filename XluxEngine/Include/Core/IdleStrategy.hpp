@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include "Core/Types.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+#if defined(_WIN32) || defined(_WIN64)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+#define XLUX_CPU_RELAX() _mm_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define XLUX_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define XLUX_CPU_RELAX() std::atomic_signal_fence(std::memory_order::seq_cst)
+#endif
+
+namespace xlux {
+
+// How a thread waits for work or for other threads. It first spins, which
+// has the lowest wake up latency, then yields its time slice, and finally
+// parks until it is notified so that idle threads do not hold on to a core.
+struct IdleStrategy {
+  // rounds of a cpu pause hint before yielding
+  U32 spinCount = 256;
+  // rounds of std::this_thread::yield() before parking
+  U32 yieldCount = 32;
+  // without parking the thread keeps yielding for as long as it waits
+  Bool allowParking = true;
+};
+
+// Counts the idle rounds of a waiting thread and spins or yields as told by
+// its IdleStrategy.
+class IdleBackoff {
+ public:
+  IdleBackoff(const IdleStrategy& strategy) : m_Strategy(strategy) {}
+
+  // spins or yields once, returns false once the thread should park instead
+  inline Bool Idle() {
+    if (m_Rounds < m_Strategy.spinCount) {
+      ++m_Rounds;
+      XLUX_CPU_RELAX();
+      return true;
+    }
+
+    if (m_Rounds < m_Strategy.spinCount + m_Strategy.yieldCount ||
+        !m_Strategy.allowParking) {
+      ++m_Rounds;
+      std::this_thread::yield();
+      return true;
+    }
+
+    return false;
+  }
+
+  inline void Reset() { m_Rounds = 0; }
+
+ private:
+  const IdleStrategy& m_Strategy;
+  U32 m_Rounds = 0;
+};
+
+// Event count to park threads on until some condition holds. It is built on
+// std::atomic wait and notify, which are a futex on linux and WaitOnAddress
+// on windows. Notifying costs a fence and a load while nobody is parked. The
+// notifying thread must make the condition true before calling Notify.
+class Parker {
+ public:
+  Parker() = default;
+  Parker(Parker&) = delete;
+  Parker(Parker&&) = delete;
+
+  // parks the calling thread until ready() returns true
+  template <typename Predicate>
+  void ParkUntil(Predicate&& ready) {
+    while (!ready()) {
+      m_WaiterCount.fetch_add(1, std::memory_order::seq_cst);
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      const U32 epoch = m_Epoch.load(std::memory_order::seq_cst);
+
+      // checked again, a notification that came before the waiter was
+      // counted would be missed otherwise
+      if (ready()) {
+        m_WaiterCount.fetch_sub(1, std::memory_order::relaxed);
+        return;
+      }
+
+      m_Epoch.wait(epoch, std::memory_order::seq_cst);
+      m_WaiterCount.fetch_sub(1, std::memory_order::relaxed);
+    }
+  }
+
+  // wakes every parked thread
+  inline void Notify() {
+    std::atomic_thread_fence(std::memory_order::seq_cst);
+    if (m_WaiterCount.load(std::memory_order::seq_cst) > 0) {
+      m_Epoch.fetch_add(1, std::memory_order::seq_cst);
+      m_Epoch.notify_all();
+    }
+  }
+
+ private:
+  Atomic<U32> m_Epoch = 0;
+  Atomic<U32> m_WaiterCount = 0;
+};
+
+// spins, yields and then parks until ready() returns true
+template <typename Predicate>
+inline void IdleUntil(const IdleStrategy& strategy, Parker& parker,
+                      Predicate&& ready) {
+  IdleBackoff backoff(strategy);
+  while (!ready()) {
+    if (!backoff.Idle()) {
+      parker.ParkUntil(ready);
+      return;
+    }
+  }
+}
+
+}  // namespace xlux
\ No newline at end of file
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "Core/Types.hpp"
+
+namespace xlux {
+
+// Bounded single producer, single consumer ring buffer. Items live in a fixed
+// array, so pushing and popping never allocate nor lock. Pushes must all come
+// from one thread and pops from one (possibly different) thread.
+template <typename T, U32 Capacity>
+  requires(Capacity > 0 && (Capacity & (Capacity - 1)) == 0)
+class RingBuffer {
+ public:
+  RingBuffer() = default;
+  RingBuffer(RingBuffer<T, Capacity>&) = delete;
+  RingBuffer(RingBuffer<T, Capacity>&&) = delete;
+
+  // pushes as many of the items as fit, returns how many were pushed
+  U32 TryPush(const T* items, U32 count) {
+    const U32 tail = m_Tail.load(std::memory_order::relaxed);
+    if (Capacity - (tail - m_CachedHead) < count) {
+      m_CachedHead = m_Head.load(std::memory_order::acquire);
+    }
+
+    const U32 pushed = std::min(count, Capacity - (tail - m_CachedHead));
+    for (U32 i = 0; i < pushed; ++i) {
+      m_Items[(tail + i) & k_Mask] = items[i];
+    }
+    m_Tail.store(tail + pushed, std::memory_order::release);
+    return pushed;
+  }
+
+  // pops up to count items, returns how many were popped
+  U32 TryPop(T* items, U32 count) {
+    const U32 head = m_Head.load(std::memory_order::relaxed);
+    if (m_CachedTail - head < count) {
+      m_CachedTail = m_Tail.load(std::memory_order::acquire);
+    }
+
+    const U32 popped = std::min(count, m_CachedTail - head);
+    for (U32 i = 0; i < popped; ++i) {
+      items[i] = std::move(m_Items[(head + i) & k_Mask]);
+    }
+    m_Head.store(head + popped, std::memory_order::release);
+    return popped;
+  }
+
+  inline Bool TryPush(const T& item) { return TryPush(&item, 1) == 1; }
+  inline Bool TryPop(T& item) { return TryPop(&item, 1) == 1; }
+
+  // exact only on the producer or the consumer thread
+  inline U32 Size() const {
+    const U32 head = m_Head.load(std::memory_order::acquire);
+    return m_Tail.load(std::memory_order::acquire) - head;
+  }
+
+  inline Bool IsEmpty() const { return Size() == 0; }
+
+  static constexpr U32 GetCapacity() { return Capacity; }
+
+ private:
+  static constexpr U32 k_Mask = Capacity - 1;
+  static constexpr U32 k_CacheLineSize = 64;
+
+  // the consumer and producer ends are kept on separate cache lines
+  alignas(k_CacheLineSize) Atomic<U32> m_Head = 0;
+  U32 m_CachedTail = 0;
+  alignas(k_CacheLineSize) Atomic<U32> m_Tail = 0;
+  U32 m_CachedHead = 0;
+  alignas(k_CacheLineSize) Array<T, Capacity> m_Items = {};
+};
+
+// Bounded ring buffer any number of threads may push to and pop from at
+// once. Every slot carries a sequence number telling whether it is free for
+// the push or filled for the pop of the current lap, so neither end locks.
+template <typename T, U32 Capacity>
+  requires(Capacity > 0 && (Capacity & (Capacity - 1)) == 0)
+class ConcurrentRingBuffer {
+ public:
+  ConcurrentRingBuffer() {
+    for (U32 i = 0; i < Capacity; ++i) {
+      m_Slots[i].sequence.store(i, std::memory_order::relaxed);
+    }
+  }
+  ConcurrentRingBuffer(ConcurrentRingBuffer<T, Capacity>&) = delete;
+  ConcurrentRingBuffer(ConcurrentRingBuffer<T, Capacity>&&) = delete;
+
+  Bool TryPush(const T& item) {
+    U32 tail = m_Tail.load(std::memory_order::relaxed);
+    while (true) {
+      auto& slot = m_Slots[tail & k_Mask];
+      const U32 sequence = slot.sequence.load(std::memory_order::acquire);
+      const I32 lag = static_cast<I32>(sequence - tail);
+      if (lag < 0) {
+        // still filled from the previous lap
+        return false;
+      }
+
+      if (lag == 0 && m_Tail.compare_exchange_weak(
+                          tail, tail + 1, std::memory_order::relaxed)) {
+        slot.item = item;
+        slot.sequence.store(tail + 1, std::memory_order::release);
+        return true;
+      }
+
+      if (lag > 0) {
+        tail = m_Tail.load(std::memory_order::relaxed);
+      }
+    }
+  }
+
+  Bool TryPop(T& item) {
+    U32 head = m_Head.load(std::memory_order::relaxed);
+    while (true) {
+      auto& slot = m_Slots[head & k_Mask];
+      const U32 sequence = slot.sequence.load(std::memory_order::acquire);
+      const I32 lag = static_cast<I32>(sequence - (head + 1));
+      if (lag < 0) {
+        // not filled yet
+        return false;
+      }
+
+      if (lag == 0 && m_Head.compare_exchange_weak(
+                          head, head + 1, std::memory_order::relaxed)) {
+        item = std::move(slot.item);
+        slot.sequence.store(head + Capacity, std::memory_order::release);
+        return true;
+      }
+
+      if (lag > 0) {
+        head = m_Head.load(std::memory_order::relaxed);
+      }
+    }
+  }
+
+  // pushes as many of the items as fit, returns how many were pushed
+  U32 TryPush(const T* items, U32 count) {
+    U32 pushed = 0;
+    while (pushed < count && TryPush(items[pushed])) {
+      ++pushed;
+    }
+    return pushed;
+  }
+
+  // pops up to count items, returns how many were popped
+  U32 TryPop(T* items, U32 count) {
+    U32 popped = 0;
+    while (popped < count && TryPop(items[popped])) {
+      ++popped;
+    }
+    return popped;
+  }
+
+  // counts the items still being pushed as well
+  inline U32 Size() const {
+    const U32 head = m_Head.load(std::memory_order::acquire);
+    return m_Tail.load(std::memory_order::acquire) - head;
+  }
+
+  inline Bool IsEmpty() const { return Size() == 0; }
+
+  static constexpr U32 GetCapacity() { return Capacity; }
+
+ private:
+  static constexpr U32 k_Mask = Capacity - 1;
+  static constexpr U32 k_CacheLineSize = 64;
+
+  struct Slot {
+    Atomic<U32> sequence = 0;
+    T item = {};
+  };
+
+  alignas(k_CacheLineSize) Atomic<U32> m_Head = 0;
+  alignas(k_CacheLineSize) Atomic<U32> m_Tail = 0;
+  alignas(k_CacheLineSize) Array<Slot, Capacity> m_Slots;
+};
+
+// Job queue of a single worker thread, fed by any of the threads submitting
+// work to the pool. Pushing into a full queue waits for the worker to make
+// room.
+template <typename T, U32 Capacity = 1024>
+class WorkerQueue {
+ public:
+  WorkerQueue() = default;
+  WorkerQueue(WorkerQueue<T, Capacity>&) = delete;
+  WorkerQueue(WorkerQueue<T, Capacity>&&) = delete;
+
+  void Push(const T* items, U32 count) {
+    while (count > 0) {
+      const U32 pushed = m_Ring.TryPush(items, count);
+      if (pushed == 0) {
+        std::this_thread::yield();
+      }
+      items += pushed;
+      count -= pushed;
+    }
+  }
+
+  inline void Push(const T& item) { Push(&item, 1); }
+
+  inline U32 Pop(T* items, U32 count) { return m_Ring.TryPop(items, count); }
+
+  inline Bool Pop(T& item) { return m_Ring.TryPop(item); }
+
+  inline U32 Size() const { return m_Ring.Size(); }
+
+  inline Bool IsEmpty() const { return m_Ring.IsEmpty(); }
+
+ private:
+  ConcurrentRingBuffer<T, Capacity> m_Ring;
+};
+
+}  // namespace xlux
\ No newline at end of file
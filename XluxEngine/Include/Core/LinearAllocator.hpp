@@ -8,11 +8,19 @@
 
 namespace xlux {
 
+// Gives every thread its own slice to allocate from. The slices start on
+// page boundaries and are left untouched until their thread first allocates
+// from them, so a pinned thread gets the pages of its slice on its own NUMA
+// node.
 class LinearAllocator {
  public:
+  // covers the 2 MiB of transparent huge pages as well
+  static constexpr Size k_SliceAlignment = 2ull * 1024 * 1024;
+
   LinearAllocator(Size maxSize, Size threadCount);
   ~LinearAllocator();
 
+  // null once the slice of the thread is full, until the next reset
   RawPtr<U8> Allocate(Size size, Size threadId);
   void Reset();
 
@@ -23,10 +31,31 @@ class LinearAllocator {
 
  private:
   Size m_MaxSize = 0;
+  // the distance between two slices, m_MaxSize rounded up to whole pages
+  Size m_Stride = 0;
   Array<Size, 1024> m_CurrentOffset = {};
   Size m_AllocationID = 0;
   RawPtr<U8> m_Data = nullptr;
   std::mutex m_Mutex;
 };
 
+// Hands out allocators of one size and takes them back for reuse, so that
+// users which only need an allocator now and then can share a few of them.
+class LinearAllocatorPool {
+ public:
+  LinearAllocatorPool(Size maxSize, Size threadCount);
+
+  // creates a new allocator when none is free
+  RawPtr<LinearAllocator> Acquire();
+  // resets the allocator for its next user
+  void Release(RawPtr<LinearAllocator> allocator);
+
+ private:
+  Size m_MaxSize = 0;
+  Size m_ThreadCount = 0;
+  List<Scope<LinearAllocator>> m_Allocators;
+  List<RawPtr<LinearAllocator>> m_FreeAllocators;
+  std::mutex m_Mutex;
+};
+
 }  // namespace xlux
\ No newline at end of file
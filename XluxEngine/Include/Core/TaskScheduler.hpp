@@ -0,0 +1,289 @@
+#pragma once
+
+#include "Core/Core.hpp"
+#include "Core/IdleStrategy.hpp"
+#include "Core/JobQueue.hpp"
+
+#include <mutex>
+#include <optional>
+
+namespace xlux {
+
+using TaskFunction = void (*)(RawPtr<void> context, U64 argument,
+                              U32 threadID);
+
+class TaskFence;
+class TaskQueue;
+
+// A unit of work for the TaskScheduler. The context is usually shared by a
+// group of tasks, which tell their share of the work apart by the argument.
+struct Task {
+  // may be null for a task that does nothing but signal its fence
+  TaskFunction function = nullptr;
+  RawPtr<void> context = nullptr;
+  U64 argument = 0;
+  // optional, signaled once the task and the others submitted with it finish
+  RawPtr<TaskFence> fence = nullptr;
+  // filled in by the queue the task is submitted to
+  RawPtr<TaskQueue> queue = nullptr;
+};
+
+// Signaled once every task submitted with it has finished running, which
+// lets a thread wait for a group of tasks while others are still in flight.
+// A fence may also hold a continuation, a task the scheduler submits as soon
+// as the fence is signaled, so that work can be chained without a thread
+// waiting in between.
+class TaskFence {
+ public:
+  TaskFence() = default;
+  TaskFence(TaskFence&) = delete;
+  TaskFence(TaskFence&&) = delete;
+
+  // also waits for the continuation, if any, to have been submitted
+  inline Bool IsSignaled() const {
+    return m_State.load(std::memory_order::acquire) == 0;
+  }
+
+  inline void Wait(const IdleStrategy& idleStrategy = {}) {
+    IdleUntil(idleStrategy, m_Parker, [this]() { return IsSignaled(); });
+  }
+
+  friend class TaskScheduler;
+  friend class TaskQueue;
+
+ private:
+  static constexpr U64 k_HasContinuation = 1ull << 63;
+
+  // count of the unfinished tasks, k_HasContinuation is set in it while a
+  // continuation waits for them
+  Atomic<U64> m_State = 0;
+  Task m_Continuation;
+  Parker m_Parker;
+};
+
+// Bounded Chase-Lev work stealing deque. The owning thread pushes and pops
+// tasks at the bottom while any other thread may steal them from the top.
+class TaskDeque {
+ public:
+  static constexpr I64 k_Capacity = 4096;
+
+  TaskDeque() = default;
+  TaskDeque(TaskDeque&) = delete;
+  TaskDeque(TaskDeque&&) = delete;
+
+  // owner only, returns false when the deque is full
+  Bool Push(const Task& task);
+  // owner only
+  Bool Pop(Task& task);
+  // any thread, may fail spuriously when racing another thief
+  Bool Steal(Task& task);
+
+  // exact only on the owning thread
+  inline I64 GetSize() const {
+    return m_Bottom.load(std::memory_order::relaxed) -
+           m_Top.load(std::memory_order::acquire);
+  }
+
+ private:
+  // The fields are atomics as a thief may read a slot the owner is refilling,
+  // the thief then loses the race on m_Top and drops what it read.
+  struct Slot {
+    Atomic<TaskFunction> function = nullptr;
+    Atomic<RawPtr<void>> context = nullptr;
+    Atomic<U64> argument = 0;
+    Atomic<RawPtr<TaskFence>> fence = nullptr;
+    Atomic<RawPtr<TaskQueue>> queue = nullptr;
+  };
+
+  inline void Store(I64 index, const Task& task) {
+    auto& slot = m_Slots[index & (k_Capacity - 1)];
+    slot.function.store(task.function, std::memory_order::relaxed);
+    slot.context.store(task.context, std::memory_order::relaxed);
+    slot.argument.store(task.argument, std::memory_order::relaxed);
+    slot.fence.store(task.fence, std::memory_order::relaxed);
+    slot.queue.store(task.queue, std::memory_order::relaxed);
+  }
+
+  inline void Load(I64 index, Task& task) const {
+    const auto& slot = m_Slots[index & (k_Capacity - 1)];
+    task.function = slot.function.load(std::memory_order::relaxed);
+    task.context = slot.context.load(std::memory_order::relaxed);
+    task.argument = slot.argument.load(std::memory_order::relaxed);
+    task.fence = slot.fence.load(std::memory_order::relaxed);
+    task.queue = slot.queue.load(std::memory_order::relaxed);
+  }
+
+ private:
+  static constexpr U32 k_CacheLineSize = 64;
+
+  alignas(k_CacheLineSize) Atomic<I64> m_Top = 0;
+  alignas(k_CacheLineSize) Atomic<I64> m_Bottom = 0;
+  alignas(k_CacheLineSize) Array<Slot, k_Capacity> m_Slots;
+};
+
+class TaskScheduler;
+
+// A submission queue of the TaskScheduler with an inbox per worker. Workers
+// take turns between the queues when they refill their deques, so a queue
+// with a lot of work does not starve the others. A queue must only be used
+// from one thread at a time, which must not be one of the workers.
+class XLUX_API TaskQueue {
+ public:
+  TaskQueue(TaskQueue&) = delete;
+  TaskQueue(TaskQueue&&) = delete;
+  ~TaskQueue();
+
+  void Submit(const Task* tasks, U32 count);
+  // same as above, but hands all of the tasks to the given worker first
+  void SubmitTo(const Task* tasks, U32 count, U32 threadID);
+  // same as above, but the tasks can not be stolen and only ever run on the
+  // given worker
+  void SubmitPinned(const Task* tasks, U32 count, U32 threadID);
+  inline void Submit(const Task& task) { Submit(&task, 1); }
+  // Submits the task once every task submitted with the fence so far has
+  // finished, right away if they already have. A fence holds a single
+  // continuation at a time, and until it is submitted only the tasks the
+  // fence waits for may add more tasks to it.
+  void SubmitAfter(TaskFence& fence, const Task& task);
+
+  // idle once every task of the queue, and every task they spawned, has
+  // finished running
+  inline Bool IsIdle() const {
+    return m_PendingTaskCount.load(std::memory_order::acquire) == 0;
+  }
+
+  void WaitForIdle();
+
+  inline RawPtr<TaskScheduler> GetScheduler() { return m_Scheduler; }
+
+  friend class TaskScheduler;
+
+ private:
+  static constexpr U32 k_InboxCapacity = 1024;
+  static constexpr U32 k_PinnedInboxCapacity = 4096;
+  static constexpr U32 k_SubmitBatchSize = 64;
+
+  using PinnedInbox = RingBuffer<Task, k_PinnedInboxCapacity>;
+
+  struct Inbox {
+    RingBuffer<Task, k_InboxCapacity> tasks;
+    // only created by the first pinned submission, most queues never pin
+    Atomic<RawPtr<PinnedInbox>> pinnedTasks = nullptr;
+  };
+
+  TaskQueue(RawPtr<TaskScheduler> scheduler, U32 threadCount);
+
+  void AddPending(const Task* tasks, U32 count);
+  // fills in the queue of the tasks as they are pushed
+  void PushToInboxes(const Task* tasks, U32 count, U32 threadID);
+  void PushToPinnedInbox(const Task* tasks, U32 count, U32 threadID);
+
+ private:
+  RawPtr<TaskScheduler> m_Scheduler = nullptr;
+  List<Scope<Inbox>> m_Inboxes;
+  Atomic<U64> m_PendingTaskCount = 0;
+  Parker m_IdleParker;
+  U32 m_NextWorker = 0;
+};
+
+// Where the workers of a TaskScheduler run. A pinned worker stays on its
+// core, so the memory it touches first, like its slice of a LinearAllocator
+// and the framebuffer tiles it owns, is placed on the NUMA node of that core.
+struct WorkerAffinity {
+  Bool pinThreads = false;
+  // the core of each worker in turn, empty for every available core with the
+  // cores of one NUMA node next to each other
+  List<U32> cores;
+};
+
+// Runs tasks on a fixed set of worker threads, one per hardware thread unless
+// told otherwise. Tasks are submitted through TaskQueues, every worker moves
+// the tasks of its inboxes into its own deque and workers that run out of
+// tasks steal from the deques of the others. Running tasks and continuations
+// push their tasks straight to the deque of their worker. Workers only park
+// once every submitted task has finished, until then they spin and yield.
+class XLUX_API TaskScheduler {
+ public:
+  static constexpr U32 k_MaxThreadCount = 256;
+  static constexpr U32 k_MaxQueueCount = 256;
+
+  // a thread count of 0 uses std::thread::hardware_concurrency()
+  TaskScheduler(U32 threadCount = 0, const IdleStrategy& idleStrategy = {},
+                const WorkerAffinity& affinity = {});
+  ~TaskScheduler();
+
+  // Any thread may create and destroy queues. A queue must be idle when it is
+  // destroyed, it is then kept around for the next one to be created.
+  RawPtr<TaskQueue> CreateQueue();
+  void DestroyQueue(RawPtr<TaskQueue> queue);
+
+  // Only from within a running task, queues more tasks on the worker running
+  // it, threadID being the one the task was given. They belong to the same
+  // TaskQueue as the running task.
+  void Spawn(const Task* tasks, U32 count, U32 threadID);
+
+  // idle only once the tasks of every queue have also finished running
+  inline Bool IsIdle() const {
+    return m_PendingTaskCount.load(std::memory_order::acquire) == 0;
+  }
+
+  void WaitForIdle();
+
+  inline U32 GetThreadCount() const {
+    return static_cast<U32>(m_Workers.size());
+  }
+
+  inline const IdleStrategy& GetIdleStrategy() const { return m_IdleStrategy; }
+  inline const WorkerAffinity& GetAffinity() const { return m_Affinity; }
+
+  friend class TaskQueue;
+
+ private:
+  static constexpr U32 k_InboxBatchSize = 64;
+  // stands in for a worker when the submitting thread signals a fence
+  static constexpr U32 k_SubmitterThreadID = ~0u;
+
+  struct WorkerState {
+    TaskDeque deque;
+    RawPtr<TaskQueue> currentQueue = nullptr;
+    // the queue to refill from first, moved on after every refill
+    U32 nextQueue = 0;
+    U32 randomState = 0;
+    // the core the worker is pinned to, if any
+    std::optional<U32> core;
+    std::thread thread;
+  };
+
+  void Run(U32 threadID);
+  void Execute(const Task& task, U32 threadID);
+  void SignalFence(TaskFence& fence, U32 threadID);
+  void PushToDeque(const Task& task, U32 threadID);
+  void AddToFences(const Task* tasks, U32 count);
+  Bool FindTask(U32 threadID, Task& task);
+  // moves the work epoch on and wakes the parked workers, called once new
+  // tasks can be found in an inbox or a deque
+  void PublishWork();
+
+ private:
+  List<Scope<WorkerState>> m_Workers;
+  IdleStrategy m_IdleStrategy;
+  WorkerAffinity m_Affinity;
+  Atomic<Bool> m_IsAlive = false;
+  Atomic<U64> m_PendingTaskCount = 0;
+  // Bumped whenever tasks are published. An idle worker parks until it moves
+  // on from the value it read before it last looked for a task, pending
+  // tasks that it can not take do not keep it awake.
+  Atomic<U64> m_WorkEpoch = 0;
+  // idle workers park on the first, threads waiting for idle on the second
+  Parker m_WorkParker;
+  Parker m_IdleParker;
+
+  // Queues are never freed before the scheduler, workers may look into the
+  // inboxes of a queue at any time. The first m_QueueCount ones are set.
+  Array<Scope<TaskQueue>, k_MaxQueueCount> m_Queues;
+  Atomic<U32> m_QueueCount = 0;
+  List<RawPtr<TaskQueue>> m_FreeQueues;
+  std::mutex m_QueueMutex;
+};
+
+}  // namespace xlux
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Core/Core.hpp"
+#include "Core/IdleStrategy.hpp"
+#include "Core/JobQueue.hpp"
 
 namespace xlux {
 template <typename JobPayload, typename JobResult>
@@ -19,27 +21,35 @@ class PoolWorker {
  public:
   inline void Pause() { m_IsPaused = true; }
 
-  inline void Resume() { m_IsPaused = false; }
+  inline void Resume() {
+    m_IsPaused = false;
+    m_JobParker.Notify();
+  }
+
+  inline void AddJob(const JobPayload& job) { AddJobs(&job, 1); }
 
-  inline void AddJob(const JobPayload& job) {
-    std::lock_guard<std::mutex> lock(m_JobMutex);
-    m_Jobs.push(job);
+  inline void AddJobs(const JobPayload* jobs, U32 count) {
+    m_PendingJobCount.fetch_add(count, std::memory_order::relaxed);
+    m_Jobs.Push(jobs, count);
+    m_JobParker.Notify();
   }
 
-  inline Bool HasJob() const { return !m_Jobs.empty(); }
+  inline Bool HasJob() const { return !m_Jobs.IsEmpty(); }
 
   inline void WaitJobDone() {
-    while ((HasJob() && IsAlive()) || IsWorking()) {
-      std::this_thread::yield();
-    }
+    IdleUntil(m_IdleStrategy, m_DoneParker, [this]() {
+      return m_PendingJobCount.load(std::memory_order::acquire) == 0 ||
+             !IsAlive();
+    });
   }
 
+  // Results are kept until the queue is full, later ones are dropped until
+  // GetJobResult makes room again. Any thread may take them.
   inline Bool HasResult() const { return !m_JobDone.IsEmpty(); }
 
   inline JobResult GetJobResult() {
-    std::lock_guard<std::mutex> lock(m_JobDoneMutex);
-    JobResult result = m_JobDone.front();
-    m_JobDone.pop();
+    JobResult result = {};
+    m_JobDone.TryPop(result);
     return result;
   }
 
@@ -49,13 +59,13 @@ class PoolWorker {
 
   inline Bool IsPaused() const { return m_IsPaused; }
 
-  inline void SetSleepDuration(Size duration) { m_SleepDuration = duration; }
-
   template <U32 P, typename Q, typename R>
   friend class ThreadPool;
 
  private:
-  PoolWorker(RawPtr<IJob<JobPayload, JobResult>> job, Size id) {
+  PoolWorker(RawPtr<IJob<JobPayload, JobResult>> job, Size id,
+             const IdleStrategy& idleStrategy)
+      : m_IdleStrategy(idleStrategy) {
     m_ID = id;
     m_Job = job;
     m_IsAlive = true;
@@ -64,63 +74,72 @@ class PoolWorker {
 
   ~PoolWorker() {
     m_IsAlive = false;
+    m_JobParker.Notify();
+    m_DoneParker.Notify();
 
     if (m_Thread.joinable()) m_Thread.join();
   }
 
   void Run() {
-    JobPayload job;
+    Array<JobPayload, k_PopBatchSize> jobs = {};
     JobResult result;
     m_IsRunning = true;
     while (m_IsAlive) {
-      while ((m_IsPaused || m_Jobs.empty()) && m_IsAlive) {
-        std::this_thread::sleep_for(std::chrono::microseconds(m_SleepDuration));
-        // std::this_thread::yield();
-      }
+      IdleUntil(m_IdleStrategy, m_JobParker, [this]() {
+        return (!m_IsPaused && !m_Jobs.IsEmpty()) || !m_IsAlive;
+      });
 
-      if (m_Jobs.size() > 0) {
+      const U32 count = m_Jobs.Pop(jobs.data(), k_PopBatchSize);
+      if (count > 0) {
         m_IsWorking = true;
 
-        {
-          std::lock_guard<std::mutex> lock(m_JobMutex);
-          job = m_Jobs.front();
-          m_Jobs.pop();
-        }
-
-        Bool res = m_Job->Execute(job, result, m_ID);
+        for (U32 i = 0; i < count; ++i) {
+          Bool res = m_Job->Execute(jobs[i], result, m_ID);
 
-        if (res) {
-          std::lock_guard<std::mutex> lock(m_JobDoneMutex);
-          m_JobDone.push(result);
+          if (res) {
+            m_JobDone.TryPush(result);
+          }
         }
 
         m_IsWorking = false;
+        if (m_PendingJobCount.fetch_sub(count, std::memory_order::release) ==
+            count) {
+          m_DoneParker.Notify();
+        }
       }
     }
     m_IsRunning = false;
   }
 
  private:
+  static constexpr U32 k_QueueCapacity = 4096;
+  static constexpr U32 k_ResultCapacity = 1024;
+  static constexpr U32 k_PopBatchSize = 16;
+
   Size m_ID = 0;
-  std::mutex m_JobMutex;
-  std::mutex m_JobDoneMutex;
   RawPtr<IJob<JobPayload, JobResult>> m_Job;
-  Queue<JobPayload> m_Jobs;
-  Queue<JobResult> m_JobDone;
-  Bool m_IsAlive = false;
-  Bool m_IsPaused = false;
+  WorkerQueue<JobPayload, k_QueueCapacity> m_Jobs;
+  ConcurrentRingBuffer<JobResult, k_ResultCapacity> m_JobDone;
+  Atomic<U32> m_PendingJobCount = 0;
+  Atomic<Bool> m_IsAlive = false;
+  Atomic<Bool> m_IsPaused = false;
   Bool m_IsRunning = false;
-  Bool m_IsWorking = false;
+  Atomic<Bool> m_IsWorking = false;
   std::thread m_Thread;
-  Size m_SleepDuration = 10;
+  IdleStrategy m_IdleStrategy;
+  // the worker parks on the first, WaitJobDone on the second
+  Parker m_JobParker;
+  Parker m_DoneParker;
 };
 
 template <U32 JobCount, typename JobPayload, typename JobResult>
 class ThreadPool {
  public:
-  ThreadPool(RawPtr<IJob<JobPayload, JobResult>> job) {
+  ThreadPool(RawPtr<IJob<JobPayload, JobResult>> job,
+             const IdleStrategy& idleStrategy = {}) {
     for (U32 i = 0; i < JobCount; ++i) {
-      m_Workers[i] = new PoolWorker<JobPayload, JobResult>(job, i);
+      m_Workers[i] =
+          new PoolWorker<JobPayload, JobResult>(job, i, idleStrategy);
     }
   }
 
@@ -144,12 +163,18 @@ class ThreadPool {
   }
 
   inline U32 AddJob(const JobPayload& job) {
-    std::lock_guard<std::mutex> lock(m_JobMutex);
-    U32 id = (m_CurrentWorker = (m_CurrentWorker + 1) % JobCount);
+    U32 id = NextWorker();
     m_Workers[id]->AddJob(job);
     return id;
   }
 
+  // pushes all of the jobs to the next worker at once
+  inline U32 AddJobs(const JobPayload* jobs, U32 count) {
+    U32 id = NextWorker();
+    m_Workers[id]->AddJobs(jobs, count);
+    return id;
+  }
+
   inline U32 AddJobTo(const JobPayload& job, U32 threadID) {
     // std::lock_guard<std::mutex> lock(m_JobMutex); // not needed
     U32 id = threadID;
@@ -157,10 +182,16 @@ class ThreadPool {
     return id;
   }
 
+ private:
+  // jobs may be added from several threads at once
+  inline U32 NextWorker() {
+    return (m_CurrentWorker.fetch_add(1, std::memory_order::relaxed) + 1) %
+           JobCount;
+  }
+
  private:
   RawPtr<PoolWorker<JobPayload, JobResult>> m_Workers[JobCount];
-  U32 m_CurrentWorker = 0;
-  std::mutex m_JobMutex;
+  Atomic<U32> m_CurrentWorker = 0;
 };
 
 }  // namespace xlux
@@ -11,6 +11,13 @@ XLUX_API List<U8> ReadBinaryFie(const String& filepath);
 
 XLUX_API F32 GetTime();
 
+// cores the process may run on, those of one NUMA node next to each other
+XLUX_API List<U32> GetAvailableCores();
+// the NUMA node the core belongs to, 0 when it is not known
+XLUX_API U32 GetNumaNodeOfCore(U32 core);
+// returns false when the platform does not support pinning threads
+XLUX_API Bool PinCurrentThreadToCore(U32 core);
+
 XLUX_API Bool IsPointInTriangle(const math::Vec2& p, const math::Vec2& a,
                                 const math::Vec2& b, const math::Vec2& c);
 
@@ -4,47 +4,12 @@
 #include <atomic>
 #include <shared_mutex>
 #include "Core/Core.hpp"
+#include "Core/IdleStrategy.hpp"
+#include "Core/JobQueue.hpp"
 #include "Core/Logger.hpp"
 #include "Core/Types.hpp"
 
 namespace xlux {
-template <typename T>
-class WorkerQueue {
- public:
-  WorkerQueue() = default;
-  WorkerQueue(WorkerQueue<T>&) = delete;
-  WorkerQueue(WorkerQueue<T>&&) = delete;
-
-  void Push(const T& item) {
-    std::unique_lock lock(m_Mutex);
-    m_Queue.push(item);
-  }
-
-  bool Pop(T& item) {
-    std::unique_lock lock(m_Mutex);
-    if (m_Queue.empty()) {
-      return false;
-    }
-    item = std::move(m_Queue.front());
-    m_Queue.pop();
-    return true;
-  }
-
-  U32 Size() const {
-    std::unique_lock lock(m_Mutex);
-    return static_cast<U32>(m_Queue.size());
-  }
-
-  bool IsEmpty() const {
-    std::unique_lock lock(m_Mutex);
-    return m_Queue.empty();
-  }
-
- private:
-  std::queue<T> m_Queue;
-  mutable std::mutex m_Mutex;
-};
-
 template <typename JobWorker, typename JobPayload>
 concept CJobWorker = requires(JobWorker w, JobPayload p, U32 threadId) {
   { w.Execute(p, threadId) } -> std::same_as<bool>;
@@ -62,6 +27,8 @@ class Worker {
 
   ~Worker() {
     m_IsAlive.clear();
+    m_JobParker.Notify();
+    m_DoneParker.Notify();
     if (m_Thread.joinable()) {
       m_Thread.join();
     }
@@ -73,34 +40,57 @@ class Worker {
 
   U32 GetQueueSize() const { return m_JobQueue.Size(); }
 
-  Bool IsIdle() const { return m_JobQueue.IsEmpty(); }
+  // idle only once every queued job has also finished executing
+  Bool IsIdle() const {
+    return m_PendingJobCount.load(std::memory_order::acquire) == 0;
+  }
 
-  void WaitForIdle() const {
-    while (!IsIdle()) {
-      std::this_thread::yield();
-    }
+  void WaitForIdle() {
+    IdleUntil(m_IdleStrategy, m_DoneParker, [this]() { return IsIdle(); });
   }
 
-  void AddJob(const JobPayload& job) { m_JobQueue.Push(job); }
+  void AddJob(const JobPayload& job) { AddJobs(&job, 1); }
+
+  void AddJobs(const JobPayload* jobs, U32 count) {
+    m_PendingJobCount.fetch_add(count, std::memory_order::relaxed);
+    m_JobQueue.Push(jobs, count);
+    m_JobParker.Notify();
+  }
 
  private:
   void Run() {
     this->m_IsAlive.test_and_set();
+    Array<JobPayload, k_PopBatchSize> jobs = {};
     while (this->m_IsAlive.test(std::memory_order::relaxed)) {
-      JobPayload job = {};
-      if (m_JobQueue.Pop(job)) {
-        if (!m_JobFunction->Execute(job, m_ID)) {
+      IdleUntil(m_IdleStrategy, m_JobParker,
+                [this]() { return !m_JobQueue.IsEmpty() || !IsAlive(); });
+
+      const U32 count = m_JobQueue.Pop(jobs.data(), k_PopBatchSize);
+      for (U32 i = 0; i < count; ++i) {
+        if (!m_JobFunction->Execute(jobs[i], m_ID)) {
           // Handle job execution failure if necessary
         }
       }
+      if (count > 0 && m_PendingJobCount.fetch_sub(
+                           count, std::memory_order::release) == count) {
+        m_DoneParker.Notify();
+      }
     }
   }
 
  private:
+  static constexpr U32 k_QueueCapacity = 4096;
+  static constexpr U32 k_PopBatchSize = 16;
+
   U32 m_ID = 0;
   RawPtr<JobWorker> m_JobFunction = nullptr;
-  WorkerQueue<JobPayload> m_JobQueue;
+  WorkerQueue<JobPayload, k_QueueCapacity> m_JobQueue;
   std::atomic_flag m_IsAlive = ATOMIC_FLAG_INIT;
+  Atomic<U32> m_PendingJobCount = 0;
+  IdleStrategy m_IdleStrategy;
+  // the worker parks on the first, WaitForIdle on the second
+  Parker m_JobParker;
+  Parker m_DoneParker;
   std::thread m_Thread;
 };
 
@@ -122,7 +112,7 @@ class WorkerPool {
     m_JobFunction.reset();
   }
 
-  void WaitForIdle() const {
+  void WaitForIdle() {
     for (const auto& worker : m_Workers) {
       worker->WaitForIdle();
     }
@@ -150,6 +140,27 @@ class WorkerPool {
     }
   }
 
+  // Deals the jobs out to the workers in turn, so neighbouring jobs, which
+  // tend to cost about the same, land on different workers. Each worker gets
+  // its share pushed in batches.
+  void AddJobs(const JobPayload* jobs, U32 count) {
+    constexpr U32 k_PushBatchSize = 16;
+    Array<JobPayload, k_PushBatchSize> batch = {};
+    for (U32 i = 0; i < WorkerCount && i < count; ++i) {
+      U32 batchCount = 0;
+      for (U32 j = i; j < count; j += WorkerCount) {
+        batch[batchCount++] = jobs[j];
+        if (batchCount == k_PushBatchSize) {
+          m_Workers[i]->AddJobs(batch.data(), batchCount);
+          batchCount = 0;
+        }
+      }
+      if (batchCount > 0) {
+        m_Workers[i]->AddJobs(batch.data(), batchCount);
+      }
+    }
+  }
+
  private:
   using Self = WorkerPool<WorkerCount, JobPayload, JobWorker>;
   using WorkerType = Worker<JobPayload, JobWorker>;
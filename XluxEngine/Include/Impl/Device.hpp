@@ -22,7 +22,14 @@ class XLUX_API Device {
   RawPtr<Buffer> CreateBuffer(Size size);
   void DestroyBuffer(RawPtr<Buffer> buffer);
 
-  RawPtr<Renderer> CreateRenderer();
+  // Every renderer of the device runs on the same workers, which the first
+  // one creates. A thread count of 0 uses one worker per hardware thread, the
+  // idle strategy tells how long the workers spin before they park and the
+  // affinity which cores they are pinned to. All three are ignored for the
+  // renderers after the first.
+  RawPtr<Renderer> CreateRenderer(U32 threadCount = 0,
+                                  const IdleStrategy& idleStrategy = {},
+                                  const WorkerAffinity& affinity = {});
   void DestroyRenderer(RawPtr<Renderer> renderer);
 
   RawPtr<Texture2D> CreateTexture2D(U32 width, U32 height, ETexelFormat format);
@@ -38,5 +45,9 @@ class XLUX_API Device {
   List<RawPtr<Buffer>> m_BufferList;
   List<RawPtr<Renderer>> m_RendererList;
   List<RawPtr<ITexture>> m_TextureList;
+
+  // shared by the renderers, created along with the first one
+  Scope<TaskScheduler> m_Scheduler = nullptr;
+  Scope<LinearAllocatorPool> m_VertexToFragmentDataPool = nullptr;
 };
 }  // namespace xlux
\ No newline at end of file
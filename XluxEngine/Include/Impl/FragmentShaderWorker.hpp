@@ -4,23 +4,163 @@
 #include "Core/ThreadPool.hpp"
 #include "Math/Math.hpp"
 #include "Impl/RendererCommon.hpp"
+#include "Impl/FrameClearWorker.hpp"
 
 namespace xlux {
 
+class TileBinner;
+struct AttributePlanes;
+
+// One job per framebuffer tile, rasterizing every triangle binned into the
+// tile in submission order.
 struct FragmentShaderWorkerInput {
-  ShaderTriangleRef triangle;
+  // set in the task argument of the tiles to clear before they are shaded
+  static constexpr U64 k_ClearTileBit = 1ull << 32;
+
   U32 slotId = 0;
+  RawPtr<IFramebuffer> framebuffer = nullptr;
+  // null when there is nothing to shade, only tiles to clear
+  RawPtr<const TileBinner> binner = nullptr;
+  RawPtr<FrameClearWorkerInput> clear = nullptr;
+  // Region to clear in framebuffer space. The tiles are in rasterizer space
+  // which has y flipped, so every tile clears the pixels it shades.
+  Pair<U32, U32> clearStart = {0, 0};
+  Pair<U32, U32> clearEnd = {0, 0};
+};
+
+struct FragmentShaderTriangleInput {
+  ShaderTriangleRef triangle;
   RawPtr<Pipeline> pipeline = nullptr;
   RawPtr<IFramebuffer> framebuffer = nullptr;
+  // set when the triangle may be rejected by, and may lower, the
+  // framebuffer hierarchical depth
+  Bool useHierarchicalDepth = false;
+  // set up lazily by the first fragment of the triangle that gets shaded
+  RawPtr<AttributePlanes> attributePlanes = nullptr;
+};
+
+// E(x, y) = a * (x - originX) + b * (y - originY), positive on the inner side
+// of the edge for counter clockwise triangles. Stepping one pixel along x adds
+// a and one pixel along y adds b.
+struct EdgeFunction {
+  F32 a = 0.0f;
+  F32 b = 0.0f;
+  F32 originX = 0.0f;
+  F32 originY = 0.0f;
+
+  inline EdgeFunction() = default;
+  inline EdgeFunction(const math::Vec4& from, const math::Vec4& to)
+      : a(from[1] - to[1]),
+        b(to[0] - from[0]),
+        originX(from[0]),
+        originY(from[1]) {}
+
+  inline F32 Evaluate(F32 x, F32 y) const {
+    return a * (x - originX) + b * (y - originY);
+  }
+};
+
+// Edge function over the fixed point vertex positions, evaluated at whole
+// pixels: e(x, y) = a * x + b * y + c in units of 1 / k_SubPixelScale. The
+// fill convention is folded into c, so a pixel is covered exactly when e is
+// positive for all three edges, and a pixel on an edge shared by two
+// triangles is covered by exactly one of them (top-left rule).
+struct FixedEdgeFunction {
+  I64 a = 0;
+  I64 b = 0;
+  I64 c = 0;
+
+  inline I64 Evaluate(I64 x, I64 y) const { return a * x + b * y + c; }
+};
+
+// Screen space plane equations of every component of the vertex to fragment
+// data of a triangle, value(x, y) = origin + ddx * (x - x0) + ddy * (y - y0).
+// Only used with interpolators reporting a linear component count.
+struct AttributePlanes {
+  static constexpr U32 k_MaxComponentCount = 256;
+
+  U32 componentCount = 0;
+  Bool isReady = false;
+  F32 x0 = 0.0f;
+  F32 y0 = 0.0f;
+  F32 origin[k_MaxComponentCount];
+  F32 ddx[k_MaxComponentCount];
+  F32 ddy[k_MaxComponentCount];
+
+  void Setup(const ShaderTriangleRef& triangle);
+
+  inline void Evaluate(F32 x, F32 y, RawPtr<F32> result) const {
+    const F32 dx = x - x0;
+    const F32 dy = y - y0;
+    for (U32 i = 0; i < componentCount; ++i) {
+      result[i] = origin[i] + ddx[i] * dx + ddy[i] * dy;
+    }
+  }
+
+  // same as above for a component count known at compile time
+  template <Size ComponentCount>
+  inline void Evaluate(F32 x, F32 y, RawPtr<F32> result) const {
+    const F32 dx = x - x0;
+    const F32 dy = y - y0;
+    for (Size i = 0; i < ComponentCount; ++i) {
+      result[i] = origin[i] + ddx[i] * dx + ddy[i] * dy;
+    }
+  }
+};
+
+// Up to 8 fragments of a triangle on a single row, lane i is the pixel
+// (x + i, y) and is shaded if bit i of mask is set. Depths hold the
+// interpolated depth and receive the shader depth when writesDepth is set.
+struct FragmentBatch {
+  RawPtr<IShader> shader = nullptr;
+  RawPtr<IInterpolator> interpolator = nullptr;
+  RawPtr<const ShaderTriangleRef> triangle = nullptr;
+  RawPtr<AttributePlanes> attributePlanes = nullptr;
+  // scratch for the interpolated data on the generic path
+  RawPtr<U8> interpolatedInput = nullptr;
+
+  U32 x = 0;
+  U32 y = 0;
+  U32 mask = 0;
+  const F32* barycentrics[3] = {nullptr, nullptr, nullptr};
+  RawPtr<F32> depths = nullptr;
+  Bool writesDepth = false;
+  RawPtr<FragmentShaderOutput> outputs = nullptr;
 };
 
 class FragmentShaderWorker {
  public:
   Bool Execute(FragmentShaderWorkerInput payload, U32 threadID);
 
+  // TaskFunction shading one tile, the context is a FragmentShaderWorkerInput
+  // shared by all tiles and the argument the tile to shade, along with
+  // k_ClearTileBit for tiles to clear first.
+  static void RunTask(RawPtr<void> context, U64 argument, U32 threadID);
+
  private:
-  Bool PointInTriangle(const math::Vec2& p, const math::Vec4& p0,
-                       const math::Vec4& p1, const math::Vec4& p2);
+  // returns true if the hierarchical depth of any block was lowered
+  Bool RasterizeEdgeFunction(const FragmentShaderTriangleInput& input,
+                             const Pair<U32, U32>& tileOffset,
+                             const Pair<U32, U32>& tileEnd,
+                             RawPtr<U8> interpolatedInput);
+  void RasterizeBarycentric(const FragmentShaderTriangleInput& input,
+                            const Pair<U32, U32>& tileOffset,
+                            const Pair<U32, U32>& tileEnd,
+                            RawPtr<U8> interpolatedInput);
+  void ShadeFragment(U32 x, U32 y, const math::Vec3& barycentric,
+                     const FragmentShaderTriangleInput& input,
+                     RawPtr<U8> interpolatedInput);
+  void ShadeFragments(FragmentBatch& batch,
+                      const FragmentShaderTriangleInput& input);
+  static void ShadeFragmentsGeneric(FragmentBatch& batch);
+  U32 CompareDepthLanes(const F32* depths, const F32* currentDepths,
+                        ECompareFunction compareFunction);
+  Bool IsOccluded(F32 nearestDepth, F32 maxDepth,
+                  ECompareFunction compareFunction);
+  // returns false for clockwise and degenerate triangles
+  Bool SetupFixedEdges(const math::Vec4& p0, const math::Vec4& p1,
+                       const math::Vec4& p2, FixedEdgeFunction* edges);
+  Bool PointInTriangle(const math::Vec2& p, const FixedEdgeFunction* edges);
   math::Vec3 CalculateBarycentric(const math::Vec2& p, const math::Vec4& a,
                                   const math::Vec4& b, const math::Vec4& c);
   Bool BlendAndApplyDepth(U32 px, U32 py, RawPtr<IFramebuffer> fbo,
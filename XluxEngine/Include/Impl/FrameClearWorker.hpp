@@ -17,7 +17,12 @@ struct FrameClearWorkerInput {
 
 class FrameClearWorker {
  public:
-  Bool Execute(FrameClearWorkerInput payload, U32 threadID);
+  static constexpr F32 k_ClearDepth = 10000000.0f;
+
+  // clears the pixels from start up to end, in framebuffer space
+  static void ClearRegion(const FrameClearWorkerInput& payload,
+                          const Pair<U32, U32>& start,
+                          const Pair<U32, U32>& end);
 };
 
 }  // namespace xlux
\ No newline at end of file
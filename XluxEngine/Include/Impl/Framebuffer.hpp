@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <limits>
 #include "Core/Core.hpp"
 
 namespace xlux {
@@ -15,8 +16,11 @@ class IFramebuffer {
   virtual Pair<U32, U32> GetSize() const = 0;
   virtual void SetColorPixel(I32 channel, I32 x, I32 y, F32 r, F32 g, F32 b,
                              F32 a) = 0;
-  virtual void SetDepthPixel(I32 x, I32 y, F32 depth) {
-    (void)x, (void)y, (void)depth, throw std::runtime_error("Not implemented");
+  // Writes through WriteDepthPixel and invalidates the hierarchical depth of
+  // the pixel, which no longer bounds it.
+  inline void SetDepthPixel(I32 x, I32 y, F32 depth) {
+    WriteDepthPixel(x, y, depth);
+    InvalidateHierarchicalDepth(x, y);
   }
   virtual void GetColorPixel(I32 channel, I32 x, I32 y, F32& r, F32& g, F32& b,
                              F32& a) const = 0;
@@ -34,12 +38,7 @@ class IFramebuffer {
     return MakePair<U32, U32>(64, 64);
   }
 
-  IFramebuffer() {
-    // Initialize slot usage to 0
-    for (auto& slot : m_SlotUsage) {
-      slot.store(0, std::memory_order_relaxed);
-    }
-  }
+  IFramebuffer() = default;
   virtual ~IFramebuffer() = default;
 
   inline Pair<U32, U32> GetTileCount() const {
@@ -85,24 +84,135 @@ class IFramebuffer {
     return MakePair<U32, U32>(tileX * tileSize.x, tileY * tileSize.y);
   }
 
-  inline Bool AcquireSlot(U32 tileId, U32 threadID, U32& currentSlotOwner) {
-    if (tileId >= kMaxSlots) {
-      throw std::runtime_error("Tile ID exceeds maximum slot count");
+  // The hierarchical depth (Hi-Z) keeps a conservative upper bound of the
+  // depth stored in every 8x8 pixel block and in every tile, which lets the
+  // renderer reject occluded triangles before any per pixel work. Positions
+  // are in rasterizer space (y up), the same space the tiles are in. Depth
+  // written with SetDepthPixel invalidates the bounds of its pixel.
+  static constexpr U32 k_HiZBlockSize = 8;
+
+  // Resets every bound to "unknown" and resizes the storage to the current
+  // framebuffer size.
+  inline void InvalidateHierarchicalDepth() {
+    const auto size = GetSize();
+    const auto tileSize = GetTileSize();
+
+    m_HiZSize = size;
+    m_HiZBlockCount =
+        MakePair<U32, U32>((size.x + k_HiZBlockSize - 1) / k_HiZBlockSize,
+                           (size.y + k_HiZBlockSize - 1) / k_HiZBlockSize);
+    // a block must never be shared by two tiles as tiles are shaded in
+    // parallel
+    m_HasHiZ = HasDepthAttachment() && tileSize.x % k_HiZBlockSize == 0 &&
+               tileSize.y % k_HiZBlockSize == 0;
+
+    const auto tileCount = GetTileCount();
+    m_HiZBlocks.assign(m_HiZBlockCount.x * m_HiZBlockCount.y, k_HiZUnknown);
+    m_HiZTiles.assign(tileCount.x * tileCount.y, k_HiZUnknown);
+  }
+
+  // Resets the bounds of the block and the tile holding the pixel, given in
+  // framebuffer space like the pixel accessors.
+  inline void InvalidateHierarchicalDepth(I32 x, I32 y) {
+    const auto size = GetSize();
+    if (!m_HasHiZ || size.x != m_HiZSize.x || size.y != m_HiZSize.y ||
+        x < 0 || y < 0 || static_cast<U32>(x) >= size.x ||
+        static_cast<U32>(y) >= size.y) {
+      return;
+    }
+
+    const auto pixelX = static_cast<U32>(x);
+    const auto pixelY = size.y - 1 - static_cast<U32>(y);
+    m_HiZBlocks[(pixelY / k_HiZBlockSize) * m_HiZBlockCount.x +
+                pixelX / k_HiZBlockSize] = k_HiZUnknown;
+
+    const auto tileSize = GetTileSize();
+    m_HiZTiles[(pixelY / tileSize.y) * GetTileCount().x +
+               pixelX / tileSize.x] = k_HiZUnknown;
+  }
+
+  inline void ValidateHierarchicalDepth() {
+    const auto size = GetSize();
+    if (size.x != m_HiZSize.x || size.y != m_HiZSize.y) {
+      InvalidateHierarchicalDepth();
+    }
+  }
+
+  inline Bool HasHierarchicalDepth() const { return m_HasHiZ; }
+
+  // Called after the depth of [startX, endX) x [startY, endY) was cleared.
+  inline void ClearHierarchicalDepth(U32 startX, U32 startY, U32 endX,
+                                     U32 endY, F32 depth) {
+    if (!m_HasHiZ) return;
+
+    ForEachHiZBlock(startX, startY, endX, endY, [&](F32& maxDepth,
+                                                    Bool isCovered) {
+      maxDepth = isCovered ? depth : std::max(maxDepth, depth);
+    });
+
+    const auto tileCount = GetTileCount();
+    for (U32 tileId = 0; tileId < tileCount.x * tileCount.y; ++tileId) {
+      UpdateTileMaxDepth(tileId);
     }
-    currentSlotOwner = 0;  // Default value indicating no owner
-    return m_SlotUsage[tileId].compare_exchange_strong(
-        currentSlotOwner, threadID, std::memory_order_acquire,
-        std::memory_order_relaxed);
   }
 
-  inline void ReleaseSlot(U32 tileId) {
-    if (tileId >= kMaxSlots) {
-      throw std::runtime_error("Tile ID exceeds maximum slot count");
+  inline F32 GetTileMaxDepth(U32 tileId) const { return m_HiZTiles[tileId]; }
+
+  // Max depth of all blocks overlapping [startX, endX) x [startY, endY).
+  inline F32 GetBlockMaxDepth(U32 startX, U32 startY, U32 endX,
+                              U32 endY) const {
+    F32 result = 0.0f;
+    for (U32 by = startY / k_HiZBlockSize;
+         by < (endY + k_HiZBlockSize - 1) / k_HiZBlockSize; ++by) {
+      for (U32 bx = startX / k_HiZBlockSize;
+           bx < (endX + k_HiZBlockSize - 1) / k_HiZBlockSize; ++bx) {
+        result = std::max(result, m_HiZBlocks[by * m_HiZBlockCount.x + bx]);
+      }
     }
-    m_SlotUsage[tileId].store(0, std::memory_order_release);
+    return result;
+  }
+
+  // Called after every pixel of [startX, endX) x [startY, endY) passed the
+  // depth test with a depth no greater than the given one. Only ever lowers
+  // the bounds, UpdateTileMaxDepth must be called afterwards.
+  inline void LowerBlockMaxDepth(U32 startX, U32 startY, U32 endX, U32 endY,
+                                 F32 depth) {
+    ForEachHiZBlock(startX, startY, endX, endY, [&](F32& maxDepth,
+                                                    Bool isCovered) {
+      if (isCovered) maxDepth = std::min(maxDepth, depth);
+    });
+  }
+
+  inline void UpdateTileMaxDepth(U32 tileId) {
+    const auto offset = GetTileOffset(tileId);
+    const auto tileSize = GetTileSize();
+    m_HiZTiles[tileId] = GetBlockMaxDepth(
+        offset.x, offset.y, std::min(offset.x + tileSize.x, m_HiZSize.x),
+        std::min(offset.y + tileSize.y, m_HiZSize.y));
+  }
+
+  // For draws whose depth test may raise the stored depth.
+  inline void InvalidateTileMaxDepth(U32 tileId) {
+    const auto offset = GetTileOffset(tileId);
+    const auto tileSize = GetTileSize();
+    ForEachHiZBlock(offset.x, offset.y,
+                    std::min(offset.x + tileSize.x, m_HiZSize.x),
+                    std::min(offset.y + tileSize.y, m_HiZSize.y),
+                    [](F32& maxDepth, Bool) { maxDepth = k_HiZUnknown; });
+    m_HiZTiles[tileId] = k_HiZUnknown;
+  }
+
+ protected:
+  // The depth storage, the renderer writes through it directly as it keeps
+  // the hierarchical depth up to date itself.
+  virtual void WriteDepthPixel(I32 x, I32 y, F32 depth) {
+    (void)x, (void)y, (void)depth, throw std::runtime_error("Not implemented");
   }
 
  private:
+  friend class FragmentShaderWorker;
+  friend class FrameClearWorker;
+
   static Pair<U32, U32> CalculateTileSize(Pair<U32, U32> optimalTiling,
                                           Pair<U32, U32> viewportSize) {
     if (viewportSize.x == 0 || viewportSize.y == 0 || optimalTiling.x == 0 ||
@@ -135,7 +245,35 @@ class IFramebuffer {
     return MakePair<U32, U32>(std::move(tileSize.x), std::move(tileSize.y));
   }
 
+  // Calls function(maxDepth, isCovered) for every block overlapping the
+  // given region, isCovered is set when the region contains the whole block.
+  template <typename Function>
+  inline void ForEachHiZBlock(U32 startX, U32 startY, U32 endX, U32 endY,
+                              Function&& function) {
+    for (U32 by = startY / k_HiZBlockSize;
+         by < (endY + k_HiZBlockSize - 1) / k_HiZBlockSize; ++by) {
+      const U32 blockStartY = by * k_HiZBlockSize;
+      const U32 blockEndY =
+          std::min(blockStartY + k_HiZBlockSize, m_HiZSize.y);
+      for (U32 bx = startX / k_HiZBlockSize;
+           bx < (endX + k_HiZBlockSize - 1) / k_HiZBlockSize; ++bx) {
+        const U32 blockStartX = bx * k_HiZBlockSize;
+        const U32 blockEndX =
+            std::min(blockStartX + k_HiZBlockSize, m_HiZSize.x);
+        const Bool isCovered = startX <= blockStartX && blockEndX <= endX &&
+                               startY <= blockStartY && blockEndY <= endY;
+        function(m_HiZBlocks[by * m_HiZBlockCount.x + bx], isCovered);
+      }
+    }
+  }
+
   const static U32 kMaxSlots = 4096;
-  std::array<std::atomic<U32>, kMaxSlots> m_SlotUsage = {};
+
+  static constexpr F32 k_HiZUnknown = std::numeric_limits<F32>::infinity();
+  Bool m_HasHiZ = false;
+  Pair<U32, U32> m_HiZSize;
+  Pair<U32, U32> m_HiZBlockCount;
+  List<F32> m_HiZBlocks;
+  List<F32> m_HiZTiles;
 };
 }  // namespace xlux
\ No newline at end of file
@@ -8,6 +8,12 @@ class IInterpolator {
  public:
   virtual void ScaleAndAdd(void* dst, const void* src1, float scale) = 0;
   virtual void Reset(void* dst) = 0;
+
+  // When non zero the data is this many tightly packed F32 values, each
+  // interpolated independently. The rasterizer then sets up their plane
+  // equations once per triangle instead of calling ScaleAndAdd per pixel.
+  virtual Size GetLinearComponentCount() const { return 0; }
+
   virtual ~IInterpolator() = default;
 };
 
@@ -35,4 +41,29 @@ class BasicInterpolator : public IInterpolatorG<T> {
   virtual void Reset(T* dst) override { *dst = T(); }
 };
 
+// For vertex to fragment data made up only of F32 values (F32, Vec2, Vec3,
+// Vec4, ...), interpolates it component by component.
+template <typename T>
+class LinearInterpolator : public IInterpolatorG<T> {
+  static_assert(sizeof(T) % sizeof(F32) == 0,
+                "LinearInterpolator<T> requires T to consist of F32 only");
+
+ public:
+  static constexpr Size k_ComponentCount = sizeof(T) / sizeof(F32);
+
+  virtual void ScaleAndAdd(T* dst, const T* src, float scale) override {
+    auto dstData = reinterpret_cast<F32*>(dst);
+    auto srcData = reinterpret_cast<const F32*>(src);
+    for (Size i = 0; i < k_ComponentCount; ++i) {
+      dstData[i] += srcData[i] * scale;
+    }
+  }
+
+  virtual void Reset(T* dst) override { *dst = T(); }
+
+  virtual Size GetLinearComponentCount() const override {
+    return k_ComponentCount;
+  }
+};
+
 }  // namespace xlux
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Core/Core.hpp"
+#include "Math/Math.hpp"
+
+namespace xlux {
+
+// A cluster of neighbouring triangles of an indexed mesh, with the bounds to
+// cull it as a whole before any of its vertices are shaded.
+struct Meshlet {
+  // the triangles are the indices [indexStart, indexStart + 3 * triangleCount)
+  // of the index buffer built with the meshlets
+  U32 indexStart = 0;
+  U32 triangleCount = 0;
+  U32 vertexCount = 0;
+
+  // bounding sphere, in the space of the positions it was built from
+  math::Vec3 center = math::Vec3(0.0f, 0.0f, 0.0f);
+  F32 radius = 0.0f;
+
+  // Cone around the normals of the triangles, a cutoff of 1 when they spread
+  // too far for the meshlet to ever face away from the camera.
+  math::Vec3 coneAxis = math::Vec3(0.0f, 0.0f, 0.0f);
+  F32 coneCutoff = 1.0f;
+
+  // Whether every triangle faces away from a camera at the position, the
+  // triangles counter-clockwise around their normals facing it. Conservative,
+  // the sphere stands in for where the triangles are.
+  inline Bool IsFacingAway(const math::Vec3& cameraPosition) const {
+    const auto direction = center - cameraPosition;
+    return direction.Dot(coneAxis) >
+           coneCutoff * direction.Length() + radius;
+  }
+};
+
+// Splits the triangles of an index buffer into meshlets of at most
+// maxVertices distinct vertices and maxTriangles triangles, made of
+// neighbouring triangles so that their bounds are tight. The triangles are
+// written to meshletIndices in the order of the meshlets, which is the index
+// buffer to draw them from. The positions are three floats every
+// positionStride bytes, indexed like the vertices.
+XLUX_API List<Meshlet> BuildMeshlets(const U32* indices, U32 indexCount,
+                                     const void* positions,
+                                     Size positionStride,
+                                     List<U32>& meshletIndices,
+                                     U32 maxVertices = 64,
+                                     U32 maxTriangles = 124);
+
+}  // namespace xlux
\ No newline at end of file
@@ -5,6 +5,14 @@ namespace xlux {
 class Device;
 class IShader;
 class IInterpolator;
+struct VertexBatch;
+struct FragmentBatch;
+
+// Shades a batch of vertices.
+using VertexShadeFunction = void (*)(RawPtr<IShader> shader,
+                                     const VertexBatch& batch);
+// Interpolates and shades a batch of fragments of a triangle.
+using FragmentShadeFunction = void (*)(FragmentBatch& batch);
 
 enum EShaderStage {
   ShaderStage_Vertex,
@@ -40,6 +48,15 @@ enum ECompareFunction {
   CompareFunction_Always
 };
 
+enum ERasterizerMode {
+  // Steps the triangle edge functions incrementally across the tile and
+  // derives the barycentrics directly from the edge values.
+  RasterizerMode_EdgeFunction,
+  // Tests and computes the barycentrics of every pixel independently, kept
+  // around as a reference implementation.
+  RasterizerMode_Barycentric
+};
+
 struct XLUX_API PipelineCreateInfo {
   Size vertexItemSize = 0;
   Size vertexToFragmentDataSize = 0;
@@ -48,6 +65,18 @@ struct XLUX_API PipelineCreateInfo {
   RawPtr<IShader> fragmentShader = nullptr;
   RawPtr<IInterpolator> interpolator = nullptr;
 
+  // Optional, only computes the clip space positions of vertices and has no
+  // outputs. Triangles are culled on its positions before the vertex shader
+  // runs for their vertices, it has to agree with the vertex shader on them.
+  // Only used along with the vertex cache.
+  RawPtr<IShader> positionShader = nullptr;
+
+  // Set by TypedPipelineCreateInfo to call the shaders and the interpolator
+  // through their concrete types, null for the generic virtual calls.
+  VertexShadeFunction vertexShadeFunction = nullptr;
+  VertexShadeFunction positionShadeFunction = nullptr;
+  FragmentShadeFunction fragmentShadeFunction = nullptr;
+
   EBlendEquation blendEquation = BlendMode_Add;
   EBlendFunction srcBlendFunction = BlendFunction_SrcAlpha;
   EBlendFunction dstBlendFunction = BlendFunction_OneMinusSrcAlpha;
@@ -56,12 +85,32 @@ struct XLUX_API PipelineCreateInfo {
 
   ECompareFunction depthCompareFunction = CompareFunction_Less;
 
+  ERasterizerMode rasterizerMode = RasterizerMode_EdgeFunction;
+  // Size in pixels of the blocks each tile is split into, blocks entirely
+  // outside a triangle are skipped and blocks entirely inside it are shaded
+  // without per pixel coverage tests. Rounded up to a multiple of 8 along x,
+  // 0 treats the whole tile as a single block.
+  U32 rasterizerBlockSize = 8;
+  // Entries of the post-transform cache every vertex task keeps, rounded up
+  // to a power of two. A vertex is shaded once per task and shared by the
+  // triangles referencing its index while it stays in the cache. The
+  // vertices missing from it are shaded in batches. 0 shades the three
+  // vertices of every triangle.
+  U32 vertexCacheSize = 256;
+
   Bool cullFaceEnable = false;
   Bool depthTestEnable = false;
   Bool blendEnable = false;
   Bool rasterizerDiscardEnable = false;
+  // Clips triangles in clip space against the near and far planes. Along x
+  // and y they are only clipped once they leave a guard band far around the
+  // screen, the tiles they are binned to cut them to the framebuffer.
   Bool enableClipping = false;
   Bool enableBackfaceCulling = false;
+  // Must be set when the fragment shader overrides FragmentShaderOutput::Depth.
+  // Otherwise the depth test runs before the fragment is interpolated and
+  // shaded, so occluded fragments are never shaded at all.
+  Bool fragmentShaderWritesDepth = false;
 
   PipelineCreateInfo() = default;
   ~PipelineCreateInfo() = default;
@@ -79,14 +128,22 @@ struct XLUX_API PipelineCreateInfo {
   PipelineCreateInfo& SetShader(RawPtr<IShader> shader, EShaderStage stage) {
     if (stage == ShaderStage_Vertex) {
       vertexShader = shader;
+      vertexShadeFunction = nullptr;
     } else if (stage == ShaderStage_Fragment) {
       fragmentShader = shader;
+      fragmentShadeFunction = nullptr;
     } else {
       xlux::log::Error("Invalid shader stage");
     }
     return *this;
   }
 
+  PipelineCreateInfo& SetPositionShader(RawPtr<IShader> shader) {
+    positionShader = shader;
+    positionShadeFunction = nullptr;
+    return *this;
+  }
+
   PipelineCreateInfo& SetClippingEnable(bool enable) {
     enableClipping = enable;
     return *this;
@@ -99,6 +156,7 @@ struct XLUX_API PipelineCreateInfo {
 
   PipelineCreateInfo& SetInterpolator(RawPtr<IInterpolator> in) {
     this->interpolator = in;
+    fragmentShadeFunction = nullptr;
     return *this;
   }
 
@@ -132,6 +190,21 @@ struct XLUX_API PipelineCreateInfo {
     return *this;
   }
 
+  PipelineCreateInfo& SetRasterizerMode(ERasterizerMode mode) {
+    rasterizerMode = mode;
+    return *this;
+  }
+
+  PipelineCreateInfo& SetRasterizerBlockSize(U32 size) {
+    rasterizerBlockSize = size;
+    return *this;
+  }
+
+  PipelineCreateInfo& SetVertexCacheSize(U32 size) {
+    vertexCacheSize = size;
+    return *this;
+  }
+
   PipelineCreateInfo& SetCullFaceEnable(bool enable) {
     cullFaceEnable = enable;
     return *this;
@@ -151,6 +224,11 @@ struct XLUX_API PipelineCreateInfo {
     rasterizerDiscardEnable = enable;
     return *this;
   }
+
+  PipelineCreateInfo& SetFragmentShaderWritesDepth(bool enable) {
+    fragmentShaderWritesDepth = enable;
+    return *this;
+  }
 };
 
 class XLUX_API Pipeline {
@@ -1,35 +1,68 @@
 #pragma once
 
 #include "Core/Core.hpp"
-#include "Core/ThreadPool.hpp"
-#include "Core/WorkerPool.hpp"
+#include "Core/TaskScheduler.hpp"
 #include "Math/Math.hpp"
+#include "Math/Frustum.hpp"
 
 #include "Impl/RendererCommon.hpp"
+#include "Impl/Meshlet.hpp"
 #include "Impl/VertexShaderWorker.hpp"
 #include "Impl/FragmentShaderWorker.hpp"
 #include "Impl/FrameClearWorker.hpp"
+#include "Impl/TileBinner.hpp"
 
 namespace xlux {
 
 class XLUX_API Renderer {
  public:
   void BeginFrame();
-  void EndFrame();
+  // returns the ticket of the last batch of the frame
+  RenderTicket EndFrame();
 
+  // submits the recorded work and waits for it to finish
   void Flush();
 
+  // Submits the work recorded so far without waiting for any of it. The
+  // buffers, pipelines and framebuffers it uses must be left alone until its
+  // ticket is complete. Returns the ticket of the submitted batch.
+  RenderTicket Submit();
+  Bool IsComplete(RenderTicket ticket);
+  // submits the batch of the ticket first if it is still being recorded
+  void Wait(RenderTicket ticket);
+
   void BindFramebuffer(RawPtr<IFramebuffer> fbo);
   void BindPipeline(RawPtr<Pipeline> pipeline);
-  void Clear(Bool color = true, Bool depth = true);
+  RenderTicket Clear(Bool color = true, Bool depth = true);
   void SetViewport(I32 x, I32 y, I32 width, I32 height);
 
-  void DrawIndexed(RawPtr<Buffer> vertexBuffer, RawPtr<Buffer> indexBuffer,
-                   U32 indexCount, U32 startingVertex = 0,
-                   U32 startingIndex = 0);
-  void DrawIndexedOrdered(RawPtr<Buffer> vertexBuffer,
-                          RawPtr<Buffer> indexBuffer, U32 indexCount,
-                          U32 startingVertex = 0, U32 startingIndex = 0);
+  RenderTicket DrawIndexed(RawPtr<Buffer> vertexBuffer,
+                           RawPtr<Buffer> indexBuffer, U32 indexCount,
+                           U32 startingVertex = 0, U32 startingIndex = 0);
+  // Draws nothing when the bounds lie outside of the view, before any vertex
+  // is shaded, and is the same as DrawIndexed otherwise. The ticket is that
+  // of the batch being recorded either way.
+  RenderTicket DrawIndexed(const DrawBounds& bounds,
+                           RawPtr<Buffer> vertexBuffer,
+                           RawPtr<Buffer> indexBuffer, U32 indexCount,
+                           U32 startingVertex = 0, U32 startingIndex = 0);
+  // Every draw is committed to the tiles in submission order, triangle by
+  // triangle, so this is the same as DrawIndexed and kept for compatibility.
+  RenderTicket DrawIndexedOrdered(RawPtr<Buffer> vertexBuffer,
+                                  RawPtr<Buffer> indexBuffer, U32 indexCount,
+                                  U32 startingVertex = 0,
+                                  U32 startingIndex = 0);
+  // Draws the meshlets of an indexed mesh, skipping those outside of the
+  // view and, with backface culling, those facing away from the camera before
+  // any of their vertices are shaded. The transform is the one the vertex
+  // shader applies to the positions the meshlets were built from, the camera
+  // position is in the space of those positions.
+  RenderTicket DrawMeshlets(RawPtr<Buffer> vertexBuffer,
+                            RawPtr<Buffer> indexBuffer,
+                            const Meshlet* meshlets, U32 meshletCount,
+                            const math::Mat4x4& objectToClip,
+                            const math::Vec3& cameraPosition,
+                            U32 startingVertex = 0, U32 startingIndex = 0);
 
   inline void SetRendererUserData(void* userData) {
     m_RendererUserData = userData;
@@ -37,9 +70,26 @@ class XLUX_API Renderer {
   inline void SetClearColor(F32 r, F32 g, F32 b, F32 a) {
     m_ClearColor = {r, g, b, a};
   }
+  // Draws and clears wait for their work to finish unless detached, which
+  // lasts until the end of the frame. Detached work is only recorded until
+  // Submit, Wait or the end of the frame, and may not pick up changes made
+  // to the state of its shaders afterwards.
   inline void SetDetachedRendering(Bool detached) {
     m_DetachedRendering = detached;
   }
+  // Without stealing a tile only ever runs on its owner, which keeps its color
+  // and depth in the cache of one core, at the cost of load balancing.
+  inline void SetTileAffinity(ETileAffinity affinity,
+                              Bool allowTileStealing = true) {
+    m_TileAffinity = affinity;
+    m_AllowTileStealing = allowTileStealing;
+    m_TileOwners.clear();
+  }
+
+  // With frame pipelining EndFrame submits the frame like Submit instead of
+  // waiting for it, its tiles are shaded while the next frame runs its vertex
+  // work. Must be called outside of a frame.
+  void SetFramePipelining(Bool enabled);
 
   inline RawPtr<Pipeline> GetActivePipeline() { return m_ActivePipeline; }
   inline Viewport GetActiveViewport() { return m_ActiveViewport.value(); }
@@ -47,10 +97,72 @@ class XLUX_API Renderer {
   friend class Device;
 
  private:
-  Renderer();
+  // the scheduler and the allocators are shared by every renderer of the
+  // device, the renderer submits through a queue of its own
+  Renderer(RawPtr<TaskScheduler> scheduler,
+           RawPtr<LinearAllocatorPool> vertexToFragmentDataPool);
   ~Renderer();
 
-  Bool PassTriangleToFragmentShader(ShaderTriangleRef triangle);
+  // submits the batch first when the draw renders to another framebuffer
+  void BeginDraw();
+  // The frustum planes bounds are culled against, those the vertex worker
+  // culls triangles against. Near and far only count once triangles are
+  // clipped against them.
+  U32 GetCullingPlaneCount() const;
+  // one draw of the triangles of the ranges of indices, [x, y) each
+  void SubmitVertexTasks(RawPtr<Buffer> vertexBuffer,
+                         RawPtr<Buffer> indexBuffer,
+                         const Pair<U32, U32>* indexRanges, U32 rangeCount,
+                         U32 startingVertex, U32 startingIndex);
+  // RasterizerCallback of the vertex tasks, the context is the FrameContext
+  static Bool BinTriangle(RawPtr<void> context, RawPtr<Pipeline> pipeline,
+                          ShaderTriangleRef triangle, U64 sequence,
+                          Size threadID);
+  // submits the recorded work and waits for it on the calling thread
+  void FlushBins();
+  // hands the tile tasks to the owners of their tiles, reordering them
+  void SubmitTileTasks(RawPtr<IFramebuffer> framebuffer, List<Task>& tasks);
+  void UpdateTileOwners(RawPtr<IFramebuffer> framebuffer);
+
+  // Everything a batch of work needs until its tiles are shaded. There are
+  // two of them once work is submitted without waiting, the vertex work of a
+  // batch fills one while the tiles of the previous batch are shaded from the
+  // other.
+  struct FrameContext {
+    RawPtr<Renderer> renderer = nullptr;
+    RenderTicket ticket = 0;
+    // taken from the pool by the first draw and given back on recycling
+    RawPtr<LinearAllocator> vertexToFragmentDataAllocator = nullptr;
+    Scope<TileBinner> tileBinner = nullptr;
+    // shared by the vertex tasks of every draw of the batch
+    List<Scope<VertexShaderWorkerInput>> drawInputs;
+    // recorded by Clear, the tiles clear themselves before they are shaded
+    std::optional<Pair<FrameClearWorkerInput, Viewport>> pendingClear;
+    // shared by the tile tasks, which may outlive the submission
+    FragmentShaderWorkerInput fragmentInput;
+    List<Task> tileTasks;
+    List<U32> tiles;
+    TaskFence vertexFence;
+    // signaled once the vertex work and the previous batch are done
+    TaskFence dispatchFence;
+    TaskFence fragmentFence;
+  };
+
+  void CreateFrame(U32 index);
+  // waits for the frame and makes it ready to record a new batch
+  void RecycleFrame(FrameContext& frame);
+  inline Bool HasRecordedWork(const FrameContext& frame) const {
+    return frame.tileBinner->GetFramebuffer() || frame.pendingClear;
+  }
+  // Hands the tiles of the batch out to the workers, clearing the
+  // hierarchical depth of the pending clear first. Runs on a worker when the
+  // batch is submitted without waiting, tile affinity is then not applied.
+  void DispatchTiles(FrameContext& frame, Bool isOnWorker, U32 threadID);
+  // TaskFunction of the dispatch, the context is the FrameContext
+  static void RunDispatchTask(RawPtr<void> context, U64 argument,
+                              U32 threadID);
+
+  inline FrameContext& GetFrame() { return *m_Frames[m_FrameIndex]; }
 
  private:
   Bool m_IsInFrame = false;
@@ -61,20 +173,39 @@ class XLUX_API Renderer {
   std::optional<Viewport> m_ActiveViewport;
   void* m_RendererUserData = nullptr;
 
-  static constexpr U32 k_VertexShaderWorkerCount = 8;
-
-  using FrameClearWorkerPoolType =
-      WorkerPool<16, FrameClearWorkerInput, FrameClearWorker>;
-  using FragmentWorkerPoolType =
-      WorkerPool<8, FragmentShaderWorkerInput, FragmentShaderWorker>;
-
-  Scope<FrameClearWorkerPoolType> m_FrameClearWorker = nullptr;
-  Scope<FragmentWorkerPoolType> m_FragmentWorker = nullptr;
-
-  RawPtr<ThreadPool<k_VertexShaderWorkerCount, VertexShaderWorkerInput, U32>>
-      m_VertexShaderThreadPool;
-  RawPtr<IJob<VertexShaderWorkerInput, U32>> m_VertexShaderJob;
-
-  RawPtr<LinearAllocator> m_VertexToFragmentDataAllocator;
+  // per worker thread and allocator of the pool, the slices only take up
+  // memory once they are written to
+  static constexpr Size k_VertexToFragmentDataSize = 1024ull * 1024 * 256;
+
+  // Every vertex task shades a contiguous range of triangles. Draws are cut
+  // in a few ranges per worker so that stealing can even out the load, but
+  // ranges never get so small that submitting them costs more than shading.
+  static constexpr U32 k_MinTrianglesPerTask = 64;
+  static constexpr U32 k_MaxTrianglesPerTask = 1024;
+  static constexpr U32 k_VertexTasksPerWorker = 4;
+
+  // vertex, fragment and clear work all runs on the same workers
+  RawPtr<TaskScheduler> m_Scheduler = nullptr;
+  RawPtr<TaskQueue> m_Queue = nullptr;
+  RawPtr<LinearAllocatorPool> m_VertexToFragmentDataPool = nullptr;
+  IdleStrategy m_IdleStrategy;
+  List<Task> m_Tasks;
+  List<Pair<U32, U32>> m_IndexRanges;
+
+  // the second frame context is created by the first Submit
+  Array<Scope<FrameContext>, 2> m_Frames;
+  U32 m_FrameIndex = 0;
+  Bool m_IsFramePipelined = false;
+  RenderTicket m_NextTicket = 1;
+  // the fragment fence of the last batch submitted without waiting, if it
+  // has not been waited for since
+  RawPtr<TaskFence> m_InFlightFence = nullptr;
+
+  ETileAffinity m_TileAffinity = TileAffinity_Dynamic;
+  Bool m_AllowTileStealing = true;
+  // the worker owning every tile, for the tile count it was built for
+  List<U32> m_TileOwners;
+  Pair<U32, U32> m_TileOwnersTileCount;
+  U32 m_DrawIndex = 0;
 };
 }  // namespace xlux
\ No newline at end of file
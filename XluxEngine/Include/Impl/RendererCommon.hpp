@@ -3,6 +3,7 @@
 #include "Core/Core.hpp"
 #include "Core/ThreadPool.hpp"
 #include "Math/Math.hpp"
+#include "Math/Frustum.hpp"
 #include "Impl/Buffer.hpp"
 #include "Impl/Shader.hpp"
 #include "Impl/Pipeline.hpp"
@@ -14,6 +15,41 @@ class Device;
 class Buffer;
 class Pipeline;
 
+// Screen space positions are snapped to a 16.8 fixed point grid before
+// rasterization, so coverage can be decided exactly in integer arithmetic.
+inline constexpr I32 k_SubPixelBits = 8;
+inline constexpr I32 k_SubPixelScale = 1 << k_SubPixelBits;
+
+// Positions are snapped within this distance of the origin, far outside of
+// any framebuffer, which keeps eight steps of an edge function within 32 bits.
+inline constexpr F32 k_MaxFixedCoordinate = 1 << 18;
+
+// Snaps a screen space coordinate to the fixed point grid, false when it is
+// out of range or not finite.
+inline Bool ToFixed(F32 value, I64& fixed) {
+  if (!std::isfinite(value) || std::abs(value) > k_MaxFixedCoordinate) {
+    return false;
+  }
+  fixed = static_cast<I64>(std::round(value * k_SubPixelScale));
+  return true;
+}
+
+// How the tiles of a framebuffer are handed to the worker threads for
+// fragment shading and clearing.
+enum ETileAffinity {
+  // every dispatch deals the tiles out anew, idle workers steal them
+  TileAffinity_Dynamic,
+  // tile i is owned by worker i % workerCount
+  TileAffinity_Interleaved,
+  // the tiles are split into contiguous runs along a Morton curve, which
+  // gives every worker a compact region of the framebuffer
+  TileAffinity_Morton
+};
+
+// Identifies the batch of work a draw or clear was recorded into. Tickets
+// grow with every batch, 0 is never handed out.
+using RenderTicket = U64;
+
 struct Viewport {
   I32 x = 0;
   I32 y = 0;
@@ -21,4 +57,49 @@ struct Viewport {
   I32 height = 0;
 };
 
+enum EDrawBoundsType { DrawBoundsType_Box, DrawBoundsType_Sphere };
+
+// What a draw covers, a box or a sphere in the space of its vertex positions,
+// along with the transform the vertex shader applies to them.
+struct DrawBounds {
+  EDrawBoundsType type = DrawBoundsType_Box;
+  math::Mat4x4 objectToClip = math::Mat4x4::Identity();
+  // the corners of the box
+  math::Vec3 minimum = math::Vec3(0.0f, 0.0f, 0.0f);
+  math::Vec3 maximum = math::Vec3(0.0f, 0.0f, 0.0f);
+  // the sphere
+  math::Vec3 center = math::Vec3(0.0f, 0.0f, 0.0f);
+  F32 radius = 0.0f;
+
+  static inline DrawBounds Box(const math::Mat4x4& objectToClip,
+                               const math::Vec3& minimum,
+                               const math::Vec3& maximum) {
+    DrawBounds bounds;
+    bounds.type = DrawBoundsType_Box;
+    bounds.objectToClip = objectToClip;
+    bounds.minimum = minimum;
+    bounds.maximum = maximum;
+    return bounds;
+  }
+
+  static inline DrawBounds Sphere(const math::Mat4x4& objectToClip,
+                                  const math::Vec3& center, F32 radius) {
+    DrawBounds bounds;
+    bounds.type = DrawBoundsType_Sphere;
+    bounds.objectToClip = objectToClip;
+    bounds.center = center;
+    bounds.radius = radius;
+    return bounds;
+  }
+
+  // whether the bounds lie entirely outside of one of the first planeCount
+  // planes of the frustum of their transform
+  inline Bool IsOutsideFrustum(U32 planeCount) const {
+    const auto frustum = math::Frustum::FromMatrix(objectToClip);
+    return type == DrawBoundsType_Sphere
+               ? frustum.IsSphereOutside(center, radius, planeCount)
+               : frustum.IsBoxOutside(minimum, maximum, planeCount);
+  }
+};
+
 }  // namespace xlux
\ No newline at end of file
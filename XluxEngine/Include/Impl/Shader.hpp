@@ -51,6 +51,18 @@ class ShaderTriangleRef {
         reinterpret_cast<U8*>(m_VertexData[2]) + vertexDataSize);
   }
 
+  // refers to vertices allocated elsewhere, which may be shared with other
+  // triangles
+  ShaderTriangleRef(const RawPtr<void>* vertexData,
+                    const RawPtr<ShaderBuiltIn>* builtIns,
+                    Size vertexDataSize) {
+    m_VertexDataSize = vertexDataSize;
+    for (U32 i = 0; i < 3; ++i) {
+      m_VertexData[i] = vertexData[i];
+      m_BuiltInRefs[i] = builtIns[i];
+    }
+  }
+
   ShaderTriangleRef() {}
 
   inline RawPtr<ShaderBuiltIn>* GetBuiltInRefs() { return m_BuiltInRefs; }
@@ -109,10 +121,110 @@ struct FragmentShaderOutput {
   inline FragmentShaderOutput() {}
 };
 
+// The vertices a vertex shader shades in one call. The inputs are gathered
+// from the vertex buffer. The outputs are written per attribute, to one
+// stream for every 32 bit word of the output type, and the clip space
+// positions to an array. Element i belongs to inputs[i] in all of them.
+struct VertexBatch {
+  U32 count = 0;
+  const RawPtr<void>* inputs = nullptr;
+  // the streams of outputs of outputSize bytes, outputStreamStride words
+  // apart, null for position shaders
+  RawPtr<F32> outputs = nullptr;
+  Size outputSize = 0;
+  U32 outputStreamStride = 0;
+  // (0, 0, 0, 1) until the shader writes them
+  RawPtr<math::Vec4> positions = nullptr;
+  // the index of every vertex in the vertex buffer
+  const U32* vertexIndices = nullptr;
+  void* userData = nullptr;
+
+  inline U32 GetOutputStreamCount() const {
+    return static_cast<U32>((outputSize + sizeof(F32) - 1) / sizeof(F32));
+  }
+  inline RawPtr<F32> GetOutputStream(U32 word) const {
+    return outputs + word * outputStreamStride;
+  }
+
+  // Spreads the output of a vertex over the streams, and gathers it back.
+  inline void StoreOutput(U32 index, const void* output) const {
+    const auto bytes = static_cast<const U8*>(output);
+    for (U32 word = 0; word < GetOutputStreamCount(); ++word) {
+      const Size offset = word * sizeof(F32);
+      std::memcpy(GetOutputStream(word) + index, bytes + offset,
+                  std::min(sizeof(F32), outputSize - offset));
+    }
+  }
+  inline void LoadOutput(U32 index, void* output) const {
+    const auto bytes = static_cast<U8*>(output);
+    for (U32 word = 0; word < GetOutputStreamCount(); ++word) {
+      const Size offset = word * sizeof(F32);
+      std::memcpy(bytes + offset, GetOutputStream(word) + index,
+                  std::min(sizeof(F32), outputSize - offset));
+    }
+  }
+};
+
+// A VertexBatch seen through the data types of an IShaderG. The streams of
+// the outputs are those of the F32 components of OutDataType, in the order
+// of its members:
+//
+//   const auto normalX = batch.GetOutputStream(
+//       offsetof(VertexOut, normal) / sizeof(F32));
+template <typename InDataType, typename OutDataType>
+class VertexBatchG {
+ public:
+  explicit VertexBatchG(const VertexBatch& batch) : m_Batch(batch) {}
+
+  inline U32 GetCount() const { return m_Batch.count; }
+  inline const InDataType& GetInput(U32 index) const {
+    return *static_cast<const InDataType*>(m_Batch.inputs[index]);
+  }
+  inline RawPtr<F32> GetOutputStream(U32 component) const {
+    return m_Batch.GetOutputStream(component);
+  }
+  // a template as OutDataType is void for position shaders
+  template <typename T = OutDataType>
+  inline void SetOutput(U32 index, const T& output) const {
+    m_Batch.StoreOutput(index, &output);
+  }
+  inline RawPtr<math::Vec4> GetPositions() const { return m_Batch.positions; }
+  inline U32 GetVertexIndex(U32 index) const {
+    return m_Batch.vertexIndices[index];
+  }
+  inline void* GetUserData() const { return m_Batch.userData; }
+
+ private:
+  const VertexBatch& m_Batch;
+};
+
 class IShader {
  public:
   virtual Bool Execute(const RawPtr<void> dataIn, RawPtr<void> dataOut,
                        RawPtr<ShaderBuiltIn> builtIn = nullptr) = 0;
+
+  // Shades a batch of vertices with one Execute call each. Vertex shaders
+  // may override it to work on the vertices of the batch together, typed
+  // pipelines call an ExecuteBatch(const VertexBatchG<In, Out>&) of the
+  // shader instead when it has one.
+  virtual Bool ExecuteBatch(const VertexBatch& batch) {
+    // every output is written here first, then stored to the streams
+    thread_local List<U8> output;
+    output.resize(batch.outputSize);
+    const auto outputData = batch.outputs ? output.data() : nullptr;
+
+    ShaderBuiltIn builtIn;
+    for (U32 i = 0; i < batch.count; ++i) {
+      builtIn.Position = batch.positions[i];
+      builtIn.VertexIndex = batch.vertexIndices[i];
+      builtIn.UserData = batch.userData;
+      Execute(batch.inputs[i], outputData, &builtIn);
+      batch.positions[i] = builtIn.Position;
+      if (outputData) batch.StoreOutput(i, outputData);
+    }
+    return true;
+  }
+
   virtual ~IShader() = default;
 };
 
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Core/Core.hpp"
+#include "Impl/RendererCommon.hpp"
+
+namespace xlux {
+
+// A screen space triangle ready for rasterization, allocated once from the
+// vertex to fragment arena and referenced from every bin it overlaps.
+// The sequence is the submission order of the triangle within the frame.
+struct BinnedTriangle {
+  ShaderTriangleRef triangle;
+  RawPtr<Pipeline> pipeline = nullptr;
+  U64 sequence = 0;
+};
+
+// Sort-middle binning of triangles into the framebuffer tiles. Every
+// producer (vertex worker) owns its own set of bins so binning needs no
+// synchronization. Workers steal triangles from each other, so a bin is not
+// in submission order, the bins of a tile are sorted back by sequence.
+class TileBinner {
+ public:
+  static constexpr U32 k_MaxProducerCount = 256;
+
+  TileBinner(U32 producerCount);
+  ~TileBinner() = default;
+
+  // Must not be called while producers are binning.
+  void Begin(RawPtr<IFramebuffer> framebuffer);
+  void Bin(RawPtr<const BinnedTriangle> binned, Size producerID);
+
+  // Collects the tiles that have at least one triangle binned into them.
+  void GetPendingTiles(List<U32>& tiles);
+  void Reset();
+
+  inline RawPtr<IFramebuffer> GetFramebuffer() const { return m_Framebuffer; }
+
+  template <typename Function>
+  inline void ForEachInOrder(U32 tileId, Function&& function) const {
+    // kept per thread so that its capacity is reused across tiles
+    thread_local List<RawPtr<const BinnedTriangle>> ordered;
+
+    ordered.clear();
+    for (U32 producer = 0; producer < m_ProducerCount; ++producer) {
+      const auto& bin = GetBin(producer, tileId);
+      ordered.insert(ordered.end(), bin.begin(), bin.end());
+    }
+
+    std::sort(ordered.begin(), ordered.end(),
+              [](RawPtr<const BinnedTriangle> a,
+                 RawPtr<const BinnedTriangle> b) {
+                return a->sequence < b->sequence;
+              });
+
+    for (auto binned : ordered) {
+      function(*binned);
+    }
+  }
+
+ private:
+  inline List<RawPtr<const BinnedTriangle>>& GetBin(U32 producer,
+                                                    U32 tileId) {
+    return m_Bins[producer * m_TileCapacity + tileId];
+  }
+
+  inline const List<RawPtr<const BinnedTriangle>>& GetBin(U32 producer,
+                                                          U32 tileId) const {
+    return m_Bins[producer * m_TileCapacity + tileId];
+  }
+
+ private:
+  U32 m_ProducerCount = 0;
+  U32 m_TileCapacity = 0;
+  Pair<U32, U32> m_TileSize;
+  Pair<U32, U32> m_TileCount;
+  RawPtr<IFramebuffer> m_Framebuffer = nullptr;
+
+  List<List<RawPtr<const BinnedTriangle>>> m_Bins;
+  List<List<U32>> m_TouchedTiles;
+  List<U8> m_IsTilePending;
+};
+
+}  // namespace xlux
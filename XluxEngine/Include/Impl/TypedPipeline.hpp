@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Core/Core.hpp"
+#include "Impl/Pipeline.hpp"
+#include "Impl/Shader.hpp"
+#include "Impl/Interpolator.hpp"
+#include "Impl/FragmentShaderWorker.hpp"
+
+#include <bit>
+
+namespace xlux {
+
+// A PipelineCreateInfo that knows the concrete vertex/fragment data, shader
+// and interpolator types. The workers then shade through functions
+// instantiated for these types, so the shader and interpolator calls are no
+// longer virtual and can be inlined into the shading loops.
+//
+//   auto pipeline = device->CreatePipeline(
+//       TypedPipelineCreateInfo<VertexInData, VertexOutData, MyVShader,
+//                               MyFShader>(vertexShader, fragmentShader,
+//                                          interpolator)
+//           .SetDepthTestEnable(true));
+//
+// Replacing a shader or the interpolator afterwards through SetShader or
+// SetInterpolator falls back to the generic path.
+template <typename VertexIn, typename VertexOut, typename VertexShader,
+          typename FragmentShader,
+          typename Interpolator = LinearInterpolator<VertexOut>>
+struct TypedPipelineCreateInfo : public PipelineCreateInfo {
+  static_assert(std::is_base_of_v<IShaderG<VertexIn, VertexOut>, VertexShader>,
+                "VertexShader must implement IShaderG<VertexIn, VertexOut>");
+  static_assert(
+      std::is_base_of_v<IShaderG<VertexOut, FragmentShaderOutput>,
+                        FragmentShader>,
+      "FragmentShader must implement IShaderG<VertexOut, FragmentShaderOutput>");
+  static_assert(std::is_base_of_v<IInterpolatorG<VertexOut>, Interpolator>,
+                "Interpolator must implement IInterpolatorG<VertexOut>");
+
+  TypedPipelineCreateInfo(RawPtr<VertexShader> vertexShader_,
+                          RawPtr<FragmentShader> fragmentShader_,
+                          RawPtr<Interpolator> interpolator_) {
+    vertexItemSize = sizeof(VertexIn);
+    vertexToFragmentDataSize = sizeof(VertexOut);
+    vertexShader = vertexShader_;
+    fragmentShader = fragmentShader_;
+    interpolator = interpolator_;
+    vertexShadeFunction = &ShadeVertices<VertexShader, VertexOut>;
+    fragmentShadeFunction = &ShadeFragments;
+  }
+
+  // The position shader is a vertex shader without outputs, an
+  // IShaderG<VertexIn, void>.
+  template <typename PositionShader>
+  TypedPipelineCreateInfo& SetPositionShader(
+      RawPtr<PositionShader> positionShader_) {
+    static_assert(
+        std::is_base_of_v<IShaderG<VertexIn, void>, PositionShader>,
+        "PositionShader must implement IShaderG<VertexIn, void>");
+    positionShader = positionShader_;
+    positionShadeFunction = &ShadeVertices<PositionShader, void>;
+    return *this;
+  }
+
+  template <typename Shader, typename Out>
+  static void ShadeVertices(RawPtr<IShader> shader, const VertexBatch& batch) {
+    auto typedShader = static_cast<RawPtr<Shader>>(shader);
+    if constexpr (k_HasBatchExecute<Shader, Out>) {
+      typedShader->Shader::ExecuteBatch(VertexBatchG<VertexIn, Out>(batch));
+    } else {
+      ShaderBuiltIn builtIn;
+      for (U32 i = 0; i < batch.count; ++i) {
+        builtIn.Position = batch.positions[i];
+        builtIn.VertexIndex = batch.vertexIndices[i];
+        builtIn.UserData = batch.userData;
+        const auto input = static_cast<RawPtr<VertexIn>>(batch.inputs[i]);
+        if constexpr (std::is_void_v<Out>) {
+          typedShader->Shader::Execute(input, nullptr, &builtIn);
+        } else {
+          // written here first, then stored to the streams
+          alignas(Out) U8 output[sizeof(Out)];
+          typedShader->Shader::Execute(
+              input, reinterpret_cast<RawPtr<Out>>(output), &builtIn);
+          batch.StoreOutput(i, output);
+        }
+        batch.positions[i] = builtIn.Position;
+      }
+    }
+  }
+
+  static void ShadeFragments(FragmentBatch& batch) {
+    auto fragmentShader = static_cast<RawPtr<FragmentShader>>(batch.shader);
+    auto interpolator = static_cast<RawPtr<Interpolator>>(batch.interpolator);
+    auto planes = batch.attributePlanes;
+    if (planes && !planes->isReady) planes->Setup(*batch.triangle);
+
+    const RawPtr<const VertexOut> vertices[3] = {
+        static_cast<RawPtr<const VertexOut>>(batch.triangle->GetVertexData(0)),
+        static_cast<RawPtr<const VertexOut>>(batch.triangle->GetVertexData(1)),
+        static_cast<RawPtr<const VertexOut>>(batch.triangle->GetVertexData(2))};
+
+    VertexOut fragmentIn;
+    for (U32 bits = batch.mask; bits; bits &= bits - 1) {
+      const auto lane = static_cast<U32>(std::countr_zero(bits));
+
+      if (planes) {
+        EvaluatePlanes(*planes, static_cast<F32>(batch.x + lane),
+                       static_cast<F32>(batch.y), fragmentIn);
+      } else {
+        interpolator->Interpolator::Reset(&fragmentIn);
+        for (U32 i = 0; i < 3; ++i) {
+          interpolator->Interpolator::ScaleAndAdd(&fragmentIn, vertices[i],
+                                                  batch.barycentrics[i][lane]);
+        }
+      }
+
+      auto& output = batch.outputs[lane];
+      output = FragmentShaderOutput();
+      output.Depth = batch.depths[lane];
+      fragmentShader->FragmentShader::Execute(&fragmentIn, &output);
+      if (batch.writesDepth) batch.depths[lane] = output.Depth;
+    }
+  }
+
+ private:
+  // whether the shader shades whole batches by itself
+  template <typename Shader, typename Out>
+  static constexpr Bool k_HasBatchExecute =
+      requires(Shader& shader, const VertexBatchG<VertexIn, Out>& batch) {
+        shader.ExecuteBatch(batch);
+      };
+
+  static inline void EvaluatePlanes(const AttributePlanes& planes, F32 x,
+                                    F32 y, VertexOut& result) {
+    if constexpr (requires { Interpolator::k_ComponentCount; }) {
+      planes.Evaluate<Interpolator::k_ComponentCount>(
+          x, y, reinterpret_cast<RawPtr<F32>>(&result));
+    } else {
+      planes.Evaluate(x, y, reinterpret_cast<RawPtr<F32>>(&result));
+    }
+  }
+};
+
+}  // namespace xlux
\ No newline at end of file
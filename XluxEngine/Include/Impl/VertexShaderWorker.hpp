@@ -8,8 +8,19 @@
 
 namespace xlux {
 
+// Receives every clipped screen space triangle along with its submission
+// sequence within the frame and the vertex worker that produced it. The
+// context is the rasterizerContext of the draw.
+using RasterizerCallback = Bool (*)(RawPtr<void> context,
+                                    RawPtr<Pipeline> pipeline,
+                                    ShaderTriangleRef triangle, U64 sequence,
+                                    Size threadID);
+
 struct VertexShaderWorkerInput {
+  // the range of indices shaded by one job, [indexStart, indexEnd)
   I32 indexStart = 0;
+  I32 indexEnd = 0;
+  U32 drawIndex = 0;
   void* userData = nullptr;
 
   Size startingVertex = 0;
@@ -20,8 +31,10 @@ struct VertexShaderWorkerInput {
 
   RawPtr<Pipeline> pipeline = nullptr;
   RawPtr<IFramebuffer> framebuffer = nullptr;
+  RawPtr<LinearAllocator> vertexToFragmentDataAllocator = nullptr;
 
-  std::function<Bool(ShaderTriangleRef)> rasterizer;
+  RasterizerCallback rasterizer = nullptr;
+  RawPtr<void> rasterizerContext = nullptr;
 };
 
 class VertexShaderWorker : public IJob<VertexShaderWorkerInput, U32> {
@@ -32,33 +45,108 @@ class VertexShaderWorker : public IJob<VertexShaderWorkerInput, U32> {
   Bool Execute(VertexShaderWorkerInput payload, U32& result,
                Size threadID) override;
 
-  inline void SetVertexToFragmentDataAllocator(
-      RawPtr<LinearAllocator> allocator) {
-    m_VertexToFragmentDataAllocator = allocator;
+  // TaskFunction shading a range of triangles, the context is the
+  // VertexShaderWorkerInput of the draw and the argument the range as made by
+  // GetTaskArgument.
+  static void RunTask(RawPtr<void> context, U64 argument, U32 threadID);
+  static inline U64 GetTaskArgument(U32 indexStart, U32 indexEnd) {
+    return (static_cast<U64>(indexEnd) << 32) | indexStart;
   }
 
  private:
-  Size ClipTrianglesAgainstPlane(const ShaderTriangleRef* triangles,
-                                 Size tianglesCountIn,
-                                 const math::Vec3& planeNormal,
-                                 const math::Vec3& planePoint, Size threadID,
-                                 const VertexShaderWorkerInput& payload,
-                                 ShaderTriangleRef* result);
-  Size ClipTriangleAgainstPlane(const ShaderTriangleRef& triangle,
-                                const math::Vec3& planeNormal,
-                                const math::Vec3& planePoint, Size threadID,
-                                Size tianglesCount,
-                                const VertexShaderWorkerInput& payload,
-                                ShaderTriangleRef* result);
-  Pair<math::Vec3, F32> PlaneIntersection(const math::Vec3& planeNormal,
-                                          const math::Vec3& planePoint,
-                                          const math::Vec3& lineStart,
-                                          const math::Vec3& lineEnd);
+  // A vertex shaded by the running task, shared by the triangles referencing
+  // its index until another index takes over its slot of the cache. Clipping
+  // makes up new ones in the same form.
+  struct CachedVertex {
+    U32 index = ~0u;
+    // null until the vertex shader ran for it, which it does not for vertices
+    // whose triangles were all culled on the positions of a position shader
+    RawPtr<void> vertex = nullptr;
+    // already mapped to the screen
+    RawPtr<ShaderBuiltIn> builtIn = nullptr;
+    // the position before the perspective divide, for culling and clipping
+    math::Vec4 clipPosition;
+    // the EClipPlane bits of the planes the vertex lies outside of
+    U32 outcode = 0;
+    // while a batch is gathered, the vertex of the batch the entry is
+    U32 record = ~0u;
+  };
+
+  // The planes of clip space. Triangles are only clipped against the near
+  // and far planes and against the guard band, which lies far enough around
+  // the screen that the rasterizer takes what is inside of it as it is. The
+  // tiles then cut triangles to the screen.
+  enum EClipPlane : U32 {
+    ClipPlane_Right = 1u << 0,
+    ClipPlane_Left = 1u << 1,
+    ClipPlane_Top = 1u << 2,
+    ClipPlane_Bottom = 1u << 3,
+    ClipPlane_Far = 1u << 4,
+    ClipPlane_Near = 1u << 5,
+    ClipPlane_GuardRight = 1u << 6,
+    ClipPlane_GuardLeft = 1u << 7,
+    ClipPlane_GuardTop = 1u << 8,
+    ClipPlane_GuardBottom = 1u << 9
+  };
+  static constexpr U32 k_ClipPlaneCount = 10;
+  static constexpr U32 k_ScreenPlanes =
+      ClipPlane_Right | ClipPlane_Left | ClipPlane_Top | ClipPlane_Bottom;
+  static constexpr U32 k_DepthPlanes = ClipPlane_Far | ClipPlane_Near;
+  static constexpr U32 k_ClippedPlanes =
+      k_DepthPlanes | ClipPlane_GuardRight | ClipPlane_GuardLeft |
+      ClipPlane_GuardTop | ClipPlane_GuardBottom;
+  // in pixels around the framebuffer, well within the positions the
+  // rasterizer handles without clamping them
+  static constexpr F32 k_GuardBandSize = 1 << 16;
+  // every clipped plane adds at most one vertex to the triangle
+  static constexpr U32 k_MaxClippedVertices = 3 + 6;
+
+  // the triangles a batch of vertices is gathered from
+  static constexpr U32 k_TrianglesPerBatch = 32;
+  static constexpr U32 k_MaxBatchSize = k_TrianglesPerBatch * 3;
+
+  // shades the triangles of [indexStart, indexEnd), at most
+  // k_TrianglesPerBatch of them, the cache may have no entries
+  void ShadeTriangles(const VertexShaderWorkerInput& payload,
+                      const U32* indices, U8* vertices, I32 indexStart,
+                      I32 indexEnd, List<CachedVertex>& cache, Size threadID);
+  // Shades some of the vertices of a batch, with the position shader only or
+  // with the vertex shader. A vertex gets its position from the first of the
+  // two that runs for it.
+  void ShadeRecords(const VertexShaderWorkerInput& payload, U8* vertices,
+                    CachedVertex* records, const U32* recordIndices, U32 count,
+                    Bool positionsOnly, Size threadID);
+  // on the positions alone, facing away, outside of one clip plane or with
+  // no area on the screen
+  Bool IsTriangleCulled(const VertexShaderWorkerInput& payload,
+                        const RawPtr<const CachedVertex>* corners);
+  void RasterizeTriangle(const VertexShaderWorkerInput& payload,
+                         const RawPtr<const CachedVertex>* corners,
+                         I32 indexStart, Size threadID);
+  // Clips a triangle against the planes its vertices lie outside of, in one
+  // pass over its polygon, and rasterizes the fan of what is left of it.
+  // New vertices are only made up where the polygon crosses a plane.
+  void ClipAndRasterize(const VertexShaderWorkerInput& payload,
+                        const RawPtr<const CachedVertex>* corners,
+                        I32 indexStart, Size threadID);
+  // the vertex at t along the edge from one vertex to the other, without
+  // vertex data once the allocator is full
+  CachedVertex Intersect(const VertexShaderWorkerInput& payload,
+                         const CachedVertex& from, const CachedVertex& to,
+                         F32 t, Size threadID);
+  static void ShadeBatch(const VertexShaderWorkerInput& payload,
+                         const VertexBatch& batch, Bool positionsOnly);
+  // the guard band along x and y, in multiples of w
+  static math::Vec2 GetGuardBand(const VertexShaderWorkerInput& payload);
+  // positive inside of the plane
+  static F32 GetClipDistance(EClipPlane plane, const math::Vec4& position,
+                             const math::Vec2& guardBand);
+  static U32 GetOutcode(const math::Vec4& position,
+                        const math::Vec2& guardBand);
+  static void MapToScreen(math::Vec4& position,
+                          const VertexShaderWorkerInput& payload);
   Bool IsTriangleFacingCamera(const math::Vec4& v0, const math::Vec4& v1,
                               const math::Vec4& v2);
-
- private:
-  RawPtr<LinearAllocator> m_VertexToFragmentDataAllocator = nullptr;
 };
 
 }  // namespace xlux
\ No newline at end of file
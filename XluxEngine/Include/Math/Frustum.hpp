@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Math/Math.hpp"
+
+namespace xlux {
+namespace math {
+
+// The planes bounding the clip volume of a transform to clip space, in the
+// space it transforms from. They are those of -w <= x, y, z <= w in clip
+// space, which is the volume the vertex worker clips against.
+struct Frustum {
+  enum EPlane {
+    Plane_Left = 0,
+    Plane_Right,
+    Plane_Bottom,
+    Plane_Top,
+    Plane_Near,
+    Plane_Far,
+    Plane_Count
+  };
+
+  // normalized, p lies inside of a plane when its Dot with Vec4(p, 1) is
+  // not negative
+  Array<Vec4, Plane_Count> planes;
+
+  static Frustum FromMatrix(const Mat4x4& toClip) {
+    Frustum frustum;
+    for (U32 i = 0; i < 3; ++i) {
+      for (U32 j = 0; j < 2; ++j) {
+        const F32 sign = j == 0 ? 1.0f : -1.0f;
+        auto& plane = frustum.planes[i * 2 + j];
+        for (U32 k = 0; k < 4; ++k) {
+          plane[k] = toClip.At(3, k) + sign * toClip.At(i, k);
+        }
+
+        const auto length = Vec3(plane).Length();
+        if (length > 0.0f) {
+          plane /= length;
+        }
+      }
+    }
+    return frustum;
+  }
+
+  // Whether the sphere lies entirely outside of one of the first planeCount
+  // planes, which leaves out near and far with Plane_Near.
+  XLUX_FORCE_INLINE Bool IsSphereOutside(const Vec3& center, F32 radius,
+                                         U32 planeCount = Plane_Count) const {
+    for (U32 i = 0; i < planeCount; ++i) {
+      if (planes[i].Dot(Vec4(center, 1.0f)) < -radius) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // the same for the box, tested with the corner furthest inside every plane
+  XLUX_FORCE_INLINE Bool IsBoxOutside(const Vec3& minimum, const Vec3& maximum,
+                                      U32 planeCount = Plane_Count) const {
+    for (U32 i = 0; i < planeCount; ++i) {
+      const auto& plane = planes[i];
+      const auto corner =
+          Vec4(plane[0] >= 0.0f ? maximum[0] : minimum[0],
+               plane[1] >= 0.0f ? maximum[1] : minimum[1],
+               plane[2] >= 0.0f ? maximum[2] : minimum[2], 1.0f);
+      if (plane.Dot(corner) < 0.0f) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+}  // namespace math
+}  // namespace xlux
\ No newline at end of file
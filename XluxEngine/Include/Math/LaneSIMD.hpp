@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+
+#include "Core/Types.hpp"
+
+#if defined(XLUX_DISABLE_SIMD)
+#define XLUX_LANES_SCALAR
+#elif defined(__AVX2__)
+#define XLUX_LANES_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XLUX_LANES_SSE
+#else
+#define XLUX_LANES_SCALAR
+#endif
+
+#if !defined(XLUX_LANES_SCALAR)
+#if defined(_WIN32) || defined(_WIN64)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+#endif
+
+namespace xlux {
+
+namespace math {
+
+// 8 wide float lanes used by the rasterizer. Maps to a single AVX2 register
+// when available, to two SSE registers on any other x64 target and to plain
+// arrays everywhere else. Comparisons return all-ones/all-zeros lane masks.
+class F32x8 {
+ public:
+  static constexpr U32 k_Width = 8;
+  static constexpr U32 k_FullMask = 0xFF;
+
+  XLUX_FORCE_INLINE F32x8() = default;
+
+  static XLUX_FORCE_INLINE F32x8 Splat(F32 value) {
+    F32x8 result;
+#if defined(XLUX_LANES_AVX2)
+    result.m_Data = _mm256_set1_ps(value);
+#elif defined(XLUX_LANES_SSE)
+    result.m_Low = result.m_High = _mm_set1_ps(value);
+#else
+    for (U32 i = 0; i < k_Width; ++i) result.m_Data[i] = value;
+#endif
+    return result;
+  }
+
+  // {start, start + 1, ..., start + 7}
+  static XLUX_FORCE_INLINE F32x8 Ramp(F32 start) {
+    F32x8 result;
+#if defined(XLUX_LANES_AVX2)
+    result.m_Data =
+        _mm256_add_ps(_mm256_set1_ps(start),
+                      _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f,
+                                     6.0f, 7.0f));
+#elif defined(XLUX_LANES_SSE)
+    result.m_Low =
+        _mm_add_ps(_mm_set1_ps(start), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+    result.m_High =
+        _mm_add_ps(_mm_set1_ps(start), _mm_setr_ps(4.0f, 5.0f, 6.0f, 7.0f));
+#else
+    for (U32 i = 0; i < k_Width; ++i) result.m_Data[i] = start + (F32)i;
+#endif
+    return result;
+  }
+
+  static XLUX_FORCE_INLINE F32x8 Load(const F32* data) {
+    F32x8 result;
+#if defined(XLUX_LANES_AVX2)
+    result.m_Data = _mm256_loadu_ps(data);
+#elif defined(XLUX_LANES_SSE)
+    result.m_Low = _mm_loadu_ps(data);
+    result.m_High = _mm_loadu_ps(data + 4);
+#else
+    for (U32 i = 0; i < k_Width; ++i) result.m_Data[i] = data[i];
+#endif
+    return result;
+  }
+
+  XLUX_FORCE_INLINE void Store(F32* data) const {
+#if defined(XLUX_LANES_AVX2)
+    _mm256_storeu_ps(data, m_Data);
+#elif defined(XLUX_LANES_SSE)
+    _mm_storeu_ps(data, m_Low);
+    _mm_storeu_ps(data + 4, m_High);
+#else
+    for (U32 i = 0; i < k_Width; ++i) data[i] = m_Data[i];
+#endif
+  }
+
+  // one bit per lane, set for lanes whose mask is all-ones
+  XLUX_FORCE_INLINE U32 MoveMask() const {
+#if defined(XLUX_LANES_AVX2)
+    return static_cast<U32>(_mm256_movemask_ps(m_Data));
+#elif defined(XLUX_LANES_SSE)
+    return static_cast<U32>(_mm_movemask_ps(m_Low)) |
+           (static_cast<U32>(_mm_movemask_ps(m_High)) << 4);
+#else
+    U32 result = 0;
+    for (U32 i = 0; i < k_Width; ++i) {
+      U32 bits = 0;
+      std::memcpy(&bits, &m_Data[i], sizeof(bits));
+      result |= (bits >> 31) << i;
+    }
+    return result;
+#endif
+  }
+
+#if defined(XLUX_LANES_AVX2)
+#define XLUX_F32X8_BINARY_OP(op, avx, sse, scalar) \
+  XLUX_FORCE_INLINE F32x8 op(const F32x8& other) const { \
+    F32x8 result;                                          \
+    result.m_Data = avx(m_Data, other.m_Data);             \
+    return result;                                         \
+  }
+#elif defined(XLUX_LANES_SSE)
+#define XLUX_F32X8_BINARY_OP(op, avx, sse, scalar) \
+  XLUX_FORCE_INLINE F32x8 op(const F32x8& other) const { \
+    F32x8 result;                                          \
+    result.m_Low = sse(m_Low, other.m_Low);                \
+    result.m_High = sse(m_High, other.m_High);             \
+    return result;                                         \
+  }
+#else
+#define XLUX_F32X8_BINARY_OP(op, avx, sse, scalar)       \
+  XLUX_FORCE_INLINE F32x8 op(const F32x8& other) const { \
+    F32x8 result;                                          \
+    for (U32 i = 0; i < k_Width; ++i) {                    \
+      const F32 a = m_Data[i], b = other.m_Data[i];        \
+      result.m_Data[i] = scalar;                           \
+    }                                                      \
+    return result;                                         \
+  }
+#endif
+
+  XLUX_F32X8_BINARY_OP(operator+, _mm256_add_ps, _mm_add_ps, a + b)
+  XLUX_F32X8_BINARY_OP(operator-, _mm256_sub_ps, _mm_sub_ps, a - b)
+  XLUX_F32X8_BINARY_OP(operator*, _mm256_mul_ps, _mm_mul_ps, a * b)
+  XLUX_F32X8_BINARY_OP(Min, _mm256_min_ps, _mm_min_ps, std::min(a, b))
+  XLUX_F32X8_BINARY_OP(Max, _mm256_max_ps, _mm_max_ps, std::max(a, b))
+  XLUX_F32X8_BINARY_OP(operator&, _mm256_and_ps, _mm_and_ps,
+                       FromBits(ToBits(a) & ToBits(b)))
+  XLUX_F32X8_BINARY_OP(operator|, _mm256_or_ps, _mm_or_ps,
+                       FromBits(ToBits(a) | ToBits(b)))
+
+#define XLUX_F32X8_AVX_CMP(predicate) \
+  [](__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, predicate); }
+
+  XLUX_F32X8_BINARY_OP(Less, XLUX_F32X8_AVX_CMP(_CMP_LT_OQ), _mm_cmplt_ps,
+                       MaskOf(a < b))
+  XLUX_F32X8_BINARY_OP(LessEqual, XLUX_F32X8_AVX_CMP(_CMP_LE_OQ),
+                       _mm_cmple_ps, MaskOf(a <= b))
+  XLUX_F32X8_BINARY_OP(Greater, XLUX_F32X8_AVX_CMP(_CMP_GT_OQ),
+                       _mm_cmpgt_ps, MaskOf(a > b))
+  XLUX_F32X8_BINARY_OP(GreaterEqual, XLUX_F32X8_AVX_CMP(_CMP_GE_OQ),
+                       _mm_cmpge_ps, MaskOf(a >= b))
+  XLUX_F32X8_BINARY_OP(Equal, XLUX_F32X8_AVX_CMP(_CMP_EQ_OQ), _mm_cmpeq_ps,
+                       MaskOf(a == b))
+  XLUX_F32X8_BINARY_OP(NotEqual, XLUX_F32X8_AVX_CMP(_CMP_NEQ_UQ),
+                       _mm_cmpneq_ps, MaskOf(a != b))
+
+#undef XLUX_F32X8_AVX_CMP
+#undef XLUX_F32X8_BINARY_OP
+
+  XLUX_FORCE_INLINE F32x8& operator+=(const F32x8& other) {
+    *this = *this + other;
+    return *this;
+  }
+
+ private:
+#if defined(XLUX_LANES_SCALAR)
+  static XLUX_FORCE_INLINE U32 ToBits(F32 value) {
+    U32 bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  static XLUX_FORCE_INLINE F32 FromBits(U32 bits) {
+    F32 value = 0.0f;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  static XLUX_FORCE_INLINE F32 MaskOf(Bool condition) {
+    return FromBits(condition ? 0xFFFFFFFFu : 0u);
+  }
+#endif
+
+ private:
+#if defined(XLUX_LANES_AVX2)
+  __m256 m_Data;
+#elif defined(XLUX_LANES_SSE)
+  __m128 m_Low;
+  __m128 m_High;
+#else
+  F32 m_Data[k_Width];
+#endif
+};
+
+// 8 wide 32 bit integer lanes, used for the fixed point edge functions. Only
+// the operations the rasterizer needs are provided, which all exist in SSE2.
+class I32x8 {
+ public:
+  static constexpr U32 k_Width = 8;
+
+  XLUX_FORCE_INLINE I32x8() = default;
+
+  static XLUX_FORCE_INLINE I32x8 Splat(I32 value) {
+    I32x8 result;
+#if defined(XLUX_LANES_AVX2)
+    result.m_Data = _mm256_set1_epi32(value);
+#elif defined(XLUX_LANES_SSE)
+    result.m_Low = result.m_High = _mm_set1_epi32(value);
+#else
+    for (U32 i = 0; i < k_Width; ++i) result.m_Data[i] = value;
+#endif
+    return result;
+  }
+
+  static XLUX_FORCE_INLINE I32x8 Load(const I32* data) {
+    I32x8 result;
+#if defined(XLUX_LANES_AVX2)
+    result.m_Data =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+#elif defined(XLUX_LANES_SSE)
+    result.m_Low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    result.m_High =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 4));
+#else
+    for (U32 i = 0; i < k_Width; ++i) result.m_Data[i] = data[i];
+#endif
+    return result;
+  }
+
+  // one bit per lane, set for lanes whose mask is all-ones
+  XLUX_FORCE_INLINE U32 MoveMask() const {
+#if defined(XLUX_LANES_AVX2)
+    return static_cast<U32>(_mm256_movemask_ps(_mm256_castsi256_ps(m_Data)));
+#elif defined(XLUX_LANES_SSE)
+    return static_cast<U32>(_mm_movemask_ps(_mm_castsi128_ps(m_Low))) |
+           (static_cast<U32>(_mm_movemask_ps(_mm_castsi128_ps(m_High))) << 4);
+#else
+    U32 result = 0;
+    for (U32 i = 0; i < k_Width; ++i) {
+      result |= (static_cast<U32>(m_Data[i]) >> 31) << i;
+    }
+    return result;
+#endif
+  }
+
+#if defined(XLUX_LANES_AVX2)
+#define XLUX_I32X8_BINARY_OP(op, avx, sse, scalar) \
+  XLUX_FORCE_INLINE I32x8 op(const I32x8& other) const { \
+    I32x8 result;                                          \
+    result.m_Data = avx(m_Data, other.m_Data);             \
+    return result;                                         \
+  }
+#elif defined(XLUX_LANES_SSE)
+#define XLUX_I32X8_BINARY_OP(op, avx, sse, scalar) \
+  XLUX_FORCE_INLINE I32x8 op(const I32x8& other) const { \
+    I32x8 result;                                          \
+    result.m_Low = sse(m_Low, other.m_Low);                \
+    result.m_High = sse(m_High, other.m_High);             \
+    return result;                                         \
+  }
+#else
+#define XLUX_I32X8_BINARY_OP(op, avx, sse, scalar)       \
+  XLUX_FORCE_INLINE I32x8 op(const I32x8& other) const { \
+    I32x8 result;                                          \
+    for (U32 i = 0; i < k_Width; ++i) {                    \
+      const I32 a = m_Data[i], b = other.m_Data[i];        \
+      result.m_Data[i] = scalar;                           \
+    }                                                      \
+    return result;                                         \
+  }
+#endif
+
+  XLUX_I32X8_BINARY_OP(operator+, _mm256_add_epi32, _mm_add_epi32, a + b)
+  XLUX_I32X8_BINARY_OP(operator|, _mm256_or_si256, _mm_or_si128, a | b)
+  XLUX_I32X8_BINARY_OP(operator&, _mm256_and_si256, _mm_and_si128, a & b)
+  XLUX_I32X8_BINARY_OP(Greater, _mm256_cmpgt_epi32, _mm_cmpgt_epi32,
+                       a > b ? -1 : 0)
+
+#undef XLUX_I32X8_BINARY_OP
+
+  XLUX_FORCE_INLINE I32x8& operator+=(const I32x8& other) {
+    *this = *this + other;
+    return *this;
+  }
+
+ private:
+#if defined(XLUX_LANES_AVX2)
+  __m256i m_Data;
+#elif defined(XLUX_LANES_SSE)
+  __m128i m_Low;
+  __m128i m_High;
+#else
+  I32 m_Data[k_Width];
+#endif
+};
+
+}  // namespace math
+}  // namespace xlux
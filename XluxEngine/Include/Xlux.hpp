@@ -8,4 +8,6 @@
 #include "Impl/Framebuffer.hpp"
 #include "Impl/Shader.hpp"
 #include "Impl/Interpolator.hpp"
+#include "Impl/TypedPipeline.hpp"
+#include "Impl/Meshlet.hpp"
 #include "Math/Math.hpp"
\ No newline at end of file
@@ -1,27 +1,40 @@
 #include "Core/LinearAllocator.hpp"
 #include "Core/Logger.hpp"
 
+#include <new>
+
 namespace xlux {
 
 LinearAllocator::LinearAllocator(Size maxSize, Size threadCount)
-    : m_MaxSize(maxSize) {
-  m_Data = new U8[maxSize * threadCount];
+    : m_MaxSize(maxSize),
+      m_Stride((maxSize + k_SliceAlignment - 1) & ~(k_SliceAlignment - 1)) {
+  m_Data = new (std::align_val_t(k_SliceAlignment)) U8[m_Stride * threadCount];
   if (m_Data == nullptr) {
     xlux::log::Error("Failed to allocate memory");
   }
 }
 
-LinearAllocator::~LinearAllocator() { delete[] m_Data; }
+LinearAllocator::~LinearAllocator() {
+  operator delete[](m_Data, std::align_val_t(k_SliceAlignment));
+}
 
 RawPtr<U8> LinearAllocator::Allocate(Size size, Size threadId) {
   // std::lock_guard<std::mutex> lock(m_Mutex);
   auto& currentOffset = m_CurrentOffset[threadId];
 
+  // keep every allocation 16 byte aligned as structs are placed in here too
+  size = (size + 15) & ~static_cast<Size>(15);
+
+  // reported once, the slice is marked as full past its end until the reset
   if (currentOffset + size > m_MaxSize) {
-    xlux::log::Error("LinearAllocator is full");
+    if (currentOffset <= m_MaxSize) {
+      xlux::log::Warn("LinearAllocator is full, dropping what does not fit");
+      currentOffset = m_MaxSize + 1;
+    }
+    return nullptr;
   }
 
-  auto ptr = m_Data + currentOffset + threadId * m_MaxSize;
+  auto ptr = m_Data + currentOffset + threadId * m_Stride;
   currentOffset += size;
 
   return ptr;
@@ -35,4 +48,27 @@ void LinearAllocator::Reset() {
   }
 }
 
+LinearAllocatorPool::LinearAllocatorPool(Size maxSize, Size threadCount)
+    : m_MaxSize(maxSize), m_ThreadCount(threadCount) {}
+
+RawPtr<LinearAllocator> LinearAllocatorPool::Acquire() {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if (!m_FreeAllocators.empty()) {
+    const auto allocator = m_FreeAllocators.back();
+    m_FreeAllocators.pop_back();
+    return allocator;
+  }
+
+  m_Allocators.push_back(
+      CreateScope<LinearAllocator>(m_MaxSize, m_ThreadCount));
+  return m_Allocators.back().get();
+}
+
+void LinearAllocatorPool::Release(RawPtr<LinearAllocator> allocator) {
+  allocator->Reset();
+
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_FreeAllocators.push_back(allocator);
+}
+
 }  // namespace xlux
\ No newline at end of file
@@ -0,0 +1,453 @@
+#include "Core/TaskScheduler.hpp"
+#include "Core/Logger.hpp"
+#include "Core/Utils.hpp"
+
+namespace xlux {
+
+Bool TaskDeque::Push(const Task& task) {
+  const I64 bottom = m_Bottom.load(std::memory_order::relaxed);
+  const I64 top = m_Top.load(std::memory_order::acquire);
+  if (bottom - top >= k_Capacity) {
+    return false;
+  }
+
+  Store(bottom, task);
+  std::atomic_thread_fence(std::memory_order::release);
+  m_Bottom.store(bottom + 1, std::memory_order::relaxed);
+  return true;
+}
+
+Bool TaskDeque::Pop(Task& task) {
+  const I64 bottom = m_Bottom.load(std::memory_order::relaxed) - 1;
+  m_Bottom.store(bottom, std::memory_order::relaxed);
+  std::atomic_thread_fence(std::memory_order::seq_cst);
+  I64 top = m_Top.load(std::memory_order::relaxed);
+
+  if (top > bottom) {
+    m_Bottom.store(bottom + 1, std::memory_order::relaxed);
+    return false;
+  }
+
+  Load(bottom, task);
+  if (top != bottom) {
+    return true;
+  }
+
+  // the last task, the thieves may be after it as well
+  const Bool isTaken = m_Top.compare_exchange_strong(
+      top, top + 1, std::memory_order::seq_cst, std::memory_order::relaxed);
+  m_Bottom.store(bottom + 1, std::memory_order::relaxed);
+  return isTaken;
+}
+
+Bool TaskDeque::Steal(Task& task) {
+  I64 top = m_Top.load(std::memory_order::acquire);
+  std::atomic_thread_fence(std::memory_order::seq_cst);
+  const I64 bottom = m_Bottom.load(std::memory_order::acquire);
+  if (top >= bottom) {
+    return false;
+  }
+
+  Load(top, task);
+  return m_Top.compare_exchange_strong(
+      top, top + 1, std::memory_order::seq_cst, std::memory_order::relaxed);
+}
+
+TaskQueue::TaskQueue(RawPtr<TaskScheduler> scheduler, U32 threadCount)
+    : m_Scheduler(scheduler) {
+  m_Inboxes.resize(threadCount);
+  for (auto& inbox : m_Inboxes) {
+    inbox = CreateScope<Inbox>();
+  }
+}
+
+TaskQueue::~TaskQueue() {
+  for (auto& inbox : m_Inboxes) {
+    delete inbox->pinnedTasks.load();
+  }
+}
+
+void TaskQueue::Submit(const Task* tasks, U32 count) {
+  // consecutive tasks go to the same worker in batches, the others steal
+  // from it when the batches are uneven
+  const U32 workerCount = m_Scheduler->GetThreadCount();
+  while (count > 0) {
+    const U32 batchCount = std::min(count, k_SubmitBatchSize);
+    SubmitTo(tasks, batchCount, m_NextWorker);
+    m_NextWorker = (m_NextWorker + 1) % workerCount;
+    tasks += batchCount;
+    count -= batchCount;
+  }
+}
+
+void TaskQueue::SubmitTo(const Task* tasks, U32 count, U32 threadID) {
+  AddPending(tasks, count);
+  PushToInboxes(tasks, count, threadID);
+}
+
+void TaskQueue::SubmitPinned(const Task* tasks, U32 count, U32 threadID) {
+  AddPending(tasks, count);
+  PushToPinnedInbox(tasks, count, threadID);
+}
+
+void TaskQueue::SubmitAfter(TaskFence& fence, const Task& task) {
+  AddPending(&task, 1);
+
+  // held by one more task meanwhile, so that the fence can not be signaled
+  // before the continuation is in place
+  fence.m_State.fetch_add(1);
+  fence.m_Continuation = task;
+  fence.m_Continuation.queue = this;
+  fence.m_State.fetch_or(TaskFence::k_HasContinuation);
+  m_Scheduler->SignalFence(fence, TaskScheduler::k_SubmitterThreadID);
+}
+
+void TaskQueue::WaitForIdle() {
+  IdleUntil(m_Scheduler->m_IdleStrategy, m_IdleParker,
+            [this]() { return IsIdle(); });
+}
+
+void TaskQueue::AddPending(const Task* tasks, U32 count) {
+  // counted before they are published, a task may finish right away
+  m_Scheduler->AddToFences(tasks, count);
+  m_PendingTaskCount.fetch_add(count);
+  m_Scheduler->m_PendingTaskCount.fetch_add(count);
+}
+
+void TaskQueue::PushToInboxes(const Task* tasks, U32 count, U32 threadID) {
+  const U32 workerCount = m_Scheduler->GetThreadCount();
+  Array<Task, k_SubmitBatchSize> batch;
+
+  // spill over to the next workers while the inbox is full
+  U32 fullInboxCount = 0;
+  while (count > 0) {
+    const U32 batchCount = std::min(count, k_SubmitBatchSize);
+    for (U32 i = 0; i < batchCount; ++i) {
+      batch[i] = tasks[i];
+      batch[i].queue = this;
+    }
+
+    const U32 pushed =
+        m_Inboxes[threadID]->tasks.TryPush(batch.data(), batchCount);
+    tasks += pushed;
+    count -= pushed;
+
+    // published batch by batch, a full inbox drains only once its worker
+    // is awake
+    if (pushed > 0) {
+      m_Scheduler->PublishWork();
+    } else {
+      threadID = (threadID + 1) % workerCount;
+      if (++fullInboxCount == workerCount) {
+        fullInboxCount = 0;
+        std::this_thread::yield();
+      }
+    }
+  }
+}
+
+void TaskQueue::PushToPinnedInbox(const Task* tasks, U32 count,
+                                  U32 threadID) {
+  auto& inbox = *m_Inboxes[threadID];
+  auto pinnedTasks = inbox.pinnedTasks.load(std::memory_order::relaxed);
+  if (!pinnedTasks) {
+    pinnedTasks = new PinnedInbox();
+    inbox.pinnedTasks.store(pinnedTasks, std::memory_order::release);
+  }
+
+  // there is no other worker to spill over to
+  Array<Task, k_SubmitBatchSize> batch;
+  while (count > 0) {
+    const U32 batchCount = std::min(count, k_SubmitBatchSize);
+    for (U32 i = 0; i < batchCount; ++i) {
+      batch[i] = tasks[i];
+      batch[i].queue = this;
+    }
+
+    const U32 pushed = pinnedTasks->TryPush(batch.data(), batchCount);
+    if (pushed > 0) {
+      m_Scheduler->PublishWork();
+    } else {
+      std::this_thread::yield();
+    }
+    tasks += pushed;
+    count -= pushed;
+  }
+}
+
+TaskScheduler::TaskScheduler(U32 threadCount,
+                             const IdleStrategy& idleStrategy,
+                             const WorkerAffinity& affinity)
+    : m_IdleStrategy(idleStrategy), m_Affinity(affinity) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  if (threadCount > k_MaxThreadCount) {
+    xlux::log::Warn("TaskScheduler: clamping {} threads to {}", threadCount,
+                    k_MaxThreadCount);
+    threadCount = k_MaxThreadCount;
+  }
+
+  // every worker state exists before any thread starts stealing from them
+  m_Workers.resize(threadCount);
+  for (U32 i = 0; i < threadCount; ++i) {
+    m_Workers[i] = CreateScope<WorkerState>();
+    m_Workers[i]->randomState = 0x9E3779B9u * (i + 1);
+  }
+
+  if (m_Affinity.pinThreads) {
+    if (m_Affinity.cores.empty()) {
+      m_Affinity.cores = utils::GetAvailableCores();
+    }
+    // neighbouring workers share a node, as do the tiles they own
+    for (U32 i = 0; i < threadCount; ++i) {
+      m_Workers[i]->core = m_Affinity.cores[i % m_Affinity.cores.size()];
+    }
+  }
+
+  m_IsAlive = true;
+  for (U32 i = 0; i < threadCount; ++i) {
+    m_Workers[i]->thread = std::thread(&TaskScheduler::Run, this, i);
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  WaitForIdle();
+
+  m_IsAlive = false;
+  m_WorkParker.Notify();
+  for (auto& worker : m_Workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+RawPtr<TaskQueue> TaskScheduler::CreateQueue() {
+  std::lock_guard<std::mutex> lock(m_QueueMutex);
+  if (!m_FreeQueues.empty()) {
+    const auto queue = m_FreeQueues.back();
+    m_FreeQueues.pop_back();
+    return queue;
+  }
+
+  const U32 queueCount = m_QueueCount.load(std::memory_order::relaxed);
+  if (queueCount == k_MaxQueueCount) {
+    xlux::log::Error("TaskScheduler: more than {} queues", k_MaxQueueCount);
+    return nullptr;
+  }
+
+  // set before it is counted, the workers only look at counted queues
+  m_Queues[queueCount] =
+      Scope<TaskQueue>(new TaskQueue(this, GetThreadCount()));
+  m_QueueCount.store(queueCount + 1, std::memory_order::release);
+  return m_Queues[queueCount].get();
+}
+
+void TaskScheduler::DestroyQueue(RawPtr<TaskQueue> queue) {
+  queue->WaitForIdle();
+
+  std::lock_guard<std::mutex> lock(m_QueueMutex);
+  m_FreeQueues.push_back(queue);
+}
+
+void TaskScheduler::Spawn(const Task* tasks, U32 count, U32 threadID) {
+  const auto queue = m_Workers[threadID]->currentQueue;
+  AddToFences(tasks, count);
+  queue->m_PendingTaskCount.fetch_add(count);
+  m_PendingTaskCount.fetch_add(count);
+  for (U32 i = 0; i < count; ++i) {
+    Task task = tasks[i];
+    task.queue = queue;
+    PushToDeque(task, threadID);
+  }
+  PublishWork();
+}
+
+void TaskScheduler::WaitForIdle() {
+  IdleUntil(m_IdleStrategy, m_IdleParker, [this]() { return IsIdle(); });
+}
+
+void TaskScheduler::Run(U32 threadID) {
+  const auto core = m_Workers[threadID]->core;
+  if (core && !utils::PinCurrentThreadToCore(*core)) {
+    xlux::log::Warn("TaskScheduler: failed to pin worker {} to core {}",
+                    threadID, *core);
+  }
+
+  Task task;
+  IdleBackoff backoff(m_IdleStrategy);
+  while (m_IsAlive.load(std::memory_order::relaxed)) {
+    // read before looking, tasks published after that move the epoch on
+    const U64 epoch = m_WorkEpoch.load(std::memory_order::acquire);
+    if (FindTask(threadID, task)) {
+      Execute(task, threadID);
+      backoff.Reset();
+      continue;
+    }
+
+    if (backoff.Idle()) {
+      continue;
+    }
+
+    // Tasks that are pending but out of reach, like continuations waiting
+    // for their fence or tasks pinned to other workers, do not keep the
+    // worker awake. The deques and inboxes are looked at again on waking.
+    m_WorkParker.ParkUntil([this, epoch]() {
+      return m_WorkEpoch.load(std::memory_order::acquire) != epoch ||
+             !m_IsAlive.load();
+    });
+    backoff.Reset();
+  }
+}
+
+void TaskScheduler::Execute(const Task& task, U32 threadID) {
+  if (task.function) {
+    // tasks spawned by this one belong to its queue
+    auto& self = *m_Workers[threadID];
+    const auto previousQueue = self.currentQueue;
+    self.currentQueue = task.queue;
+    task.function(task.context, task.argument, threadID);
+    self.currentQueue = previousQueue;
+  }
+  if (task.fence) {
+    SignalFence(*task.fence, threadID);
+  }
+
+  // the queue first, a thread waiting for it may free what the task used
+  // as soon as the queue is idle, but the queue itself is never freed
+  const auto queue = task.queue;
+  if (queue->m_PendingTaskCount.fetch_sub(1) == 1) {
+    queue->m_IdleParker.Notify();
+  }
+  if (m_PendingTaskCount.fetch_sub(1) == 1) {
+    m_IdleParker.Notify();
+  }
+}
+
+void TaskScheduler::SignalFence(TaskFence& fence, U32 threadID) {
+  const U64 state = fence.m_State.fetch_sub(1) - 1;
+  if (state == 0) {
+    fence.m_Parker.Notify();
+    return;
+  }
+
+  if (state != TaskFence::k_HasContinuation) {
+    return;
+  }
+
+  // Read before it is claimed, no new continuation can be set until then.
+  // Only one thread wins the claim when a task spawned by the ones the fence
+  // waits for takes the count to zero again.
+  const Task continuation = fence.m_Continuation;
+  U64 expected = TaskFence::k_HasContinuation;
+  if (!fence.m_State.compare_exchange_strong(expected, 0)) {
+    return;
+  }
+  fence.m_Parker.Notify();
+
+  // the continuation was counted as pending when it was set
+  if (!continuation.function) {
+    Execute(continuation, threadID);
+  } else if (threadID == k_SubmitterThreadID) {
+    const auto queue = continuation.queue;
+    queue->PushToInboxes(&continuation, 1, queue->m_NextWorker);
+    queue->m_NextWorker = (queue->m_NextWorker + 1) % GetThreadCount();
+  } else {
+    PushToDeque(continuation, threadID);
+    PublishWork();
+  }
+}
+
+void TaskScheduler::PushToDeque(const Task& task, U32 threadID) {
+  // run right away when the deque is full, the task is already counted
+  if (!m_Workers[threadID]->deque.Push(task)) {
+    Execute(task, threadID);
+  }
+}
+
+void TaskScheduler::AddToFences(const Task* tasks, U32 count) {
+  // tasks are usually submitted in runs sharing the same fence
+  RawPtr<TaskFence> fence = nullptr;
+  U64 runLength = 0;
+  for (U32 i = 0; i <= count; ++i) {
+    if (i == count || tasks[i].fence != fence) {
+      if (fence) {
+        fence->m_State.fetch_add(runLength, std::memory_order::relaxed);
+      }
+      if (i == count) {
+        break;
+      }
+      fence = tasks[i].fence;
+      runLength = 0;
+    }
+    ++runLength;
+  }
+}
+
+Bool TaskScheduler::FindTask(U32 threadID, Task& task) {
+  auto& self = *m_Workers[threadID];
+
+  // pinned tasks first, no other worker can take them off our hands
+  const U32 queueCount = m_QueueCount.load(std::memory_order::acquire);
+  for (U32 i = 0; i < queueCount; ++i) {
+    const auto& inbox = *m_Queues[i]->m_Inboxes[threadID];
+    const auto pinnedTasks =
+        inbox.pinnedTasks.load(std::memory_order::acquire);
+    if (pinnedTasks && pinnedTasks->TryPop(task)) {
+      return true;
+    }
+  }
+
+  // Newly submitted tasks are moved to the deque right away, where the other
+  // workers can steal them. Every refill starts at the next queue, so that
+  // the queues are served in turn.
+  const auto room = static_cast<U32>(
+      std::min<I64>(TaskDeque::k_Capacity - self.deque.GetSize(),
+                    k_InboxBatchSize));
+  Array<Task, k_InboxBatchSize> batch;
+  for (U32 i = 0; i < queueCount; ++i) {
+    const U32 queueIndex = (self.nextQueue + i) % queueCount;
+    auto& inbox = m_Queues[queueIndex]->m_Inboxes[threadID]->tasks;
+    const U32 received = inbox.TryPop(batch.data(), room);
+    if (received > 0) {
+      for (U32 j = 0; j < received; ++j) {
+        self.deque.Push(batch[j]);
+      }
+      // the parked workers may steal all but the one taken next
+      if (received > 1) {
+        PublishWork();
+      }
+      self.nextQueue = queueIndex + 1;
+      break;
+    }
+  }
+
+  if (self.deque.Pop(task)) {
+    return true;
+  }
+
+  // xorshift, so that idle workers do not all go after the same victim
+  self.randomState ^= self.randomState << 13;
+  self.randomState ^= self.randomState >> 17;
+  self.randomState ^= self.randomState << 5;
+
+  const U32 workerCount = GetThreadCount();
+  const U32 start = self.randomState % workerCount;
+  for (U32 i = 0; i < workerCount; ++i) {
+    const U32 victim = (start + i) % workerCount;
+    if (victim != threadID && m_Workers[victim]->deque.Steal(task)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TaskScheduler::PublishWork() {
+  m_WorkEpoch.fetch_add(1, std::memory_order::release);
+  m_WorkParker.Notify();
+}
+
+}  // namespace xlux
\ No newline at end of file
@@ -1,6 +1,12 @@
 #include "Core/Utils.hpp"
 #include "Core/Core.hpp"
 
+#if defined(PLATFORM_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <filesystem>
+#endif
+
 namespace xlux {
 namespace utils {
 XLUX_API String GetExecutablePath() {
@@ -66,6 +72,98 @@ XLUX_API F32 GetTime() {
 #endif
 }
 
+XLUX_API List<U32> GetAvailableCores() {
+  List<U32> cores;
+#if defined(PLATFORM_WINDOWS)
+  DWORD_PTR processMask = 0, systemMask = 0;
+  if (::GetProcessAffinityMask(::GetCurrentProcess(), &processMask,
+                               &systemMask)) {
+    for (U32 core = 0; core < sizeof(DWORD_PTR) * 8; ++core) {
+      if (processMask & (static_cast<DWORD_PTR>(1) << core)) {
+        cores.push_back(core);
+      }
+    }
+  }
+#elif defined(PLATFORM_LINUX)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (U32 core = 0; core < CPU_SETSIZE; ++core) {
+      if (CPU_ISSET(core, &set)) {
+        cores.push_back(core);
+      }
+    }
+  }
+#endif
+
+  if (cores.empty()) {
+    cores.resize(std::max(1u, std::thread::hardware_concurrency()));
+    for (U32 core = 0; core < cores.size(); ++core) {
+      cores[core] = core;
+    }
+  }
+
+  // cores come in ascending order, a stable sort keeps it within a node
+  std::unordered_map<U32, U32> nodes;
+  for (const auto core : cores) {
+    nodes[core] = GetNumaNodeOfCore(core);
+  }
+  std::stable_sort(cores.begin(), cores.end(), [&nodes](U32 a, U32 b) {
+    return nodes[a] < nodes[b];
+  });
+  return cores;
+}
+
+XLUX_API U32 GetNumaNodeOfCore(U32 core) {
+#if defined(PLATFORM_WINDOWS)
+  PROCESSOR_NUMBER processor = {};
+  processor.Group = 0;
+  processor.Number = static_cast<BYTE>(core);
+  USHORT node = 0;
+  if (core < 64 && ::GetNumaProcessorNodeEx(&processor, &node)) {
+    return node;
+  }
+  return 0;
+#elif defined(PLATFORM_LINUX)
+  // sysfs links the node of a cpu as a nodeN entry of its directory
+  std::error_code error;
+  const auto directory = std::filesystem::path("/sys/devices/system/cpu") /
+                         ("cpu" + std::to_string(core));
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory, error)) {
+    const auto name = entry.path().filename().string();
+    if (name.rfind("node", 0) == 0 && name.size() > 4) {
+      return static_cast<U32>(std::strtoul(name.c_str() + 4, nullptr, 10));
+    }
+  }
+  return 0;
+#else
+  (void)core;
+  return 0;
+#endif
+}
+
+XLUX_API Bool PinCurrentThreadToCore(U32 core) {
+#if defined(PLATFORM_WINDOWS)
+  if (core >= sizeof(DWORD_PTR) * 8) {
+    return false;
+  }
+  return ::SetThreadAffinityMask(::GetCurrentThread(),
+                                 static_cast<DWORD_PTR>(1) << core) != 0;
+#elif defined(PLATFORM_LINUX)
+  if (core >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)core;
+  return false;
+#endif
+}
+
 XLUX_API Bool IsPointInTriangle(const math::Vec2& p, const math::Vec2& a,
                                 const math::Vec2& b, const math::Vec2& c) {
   // Compute vectors
@@ -1,4 +1,5 @@
 #include "Impl/Device.hpp"
+#include "Core/Logger.hpp"
 
 namespace xlux {
 
@@ -77,8 +78,26 @@ void Device::DestroyBuffer(RawPtr<Buffer> buffer) {
   delete buffer;
 }
 
-RawPtr<Renderer> Device::CreateRenderer() {
-  auto renderer = new Renderer();
+RawPtr<Renderer> Device::CreateRenderer(U32 threadCount,
+                                        const IdleStrategy& idleStrategy,
+                                        const WorkerAffinity& affinity) {
+  if (!m_Scheduler) {
+    m_Scheduler =
+        CreateScope<TaskScheduler>(threadCount, idleStrategy, affinity);
+
+    const auto workerCount = m_Scheduler->GetThreadCount();
+    m_VertexToFragmentDataPool = CreateScope<LinearAllocatorPool>(
+        Renderer::k_VertexToFragmentDataSize, workerCount);
+  } else if (threadCount != 0 &&
+             threadCount != m_Scheduler->GetThreadCount()) {
+    xlux::log::Warn(
+        "Device::CreateRenderer() renderers share {} workers, ignoring the "
+        "thread count of {}",
+        m_Scheduler->GetThreadCount(), threadCount);
+  }
+
+  auto renderer =
+      new Renderer(m_Scheduler.get(), m_VertexToFragmentDataPool.get());
   m_RendererList.push_back(renderer);
   return renderer;
 }
@@ -7,29 +7,149 @@
 #include "Impl/Shader.hpp"
 #include "Impl/Framebuffer.hpp"
 #include "Impl/RendererCommon.hpp"
+#include "Impl/TileBinner.hpp"
+#include "Math/LaneSIMD.hpp"
+
+#include <bit>
+#include <limits>
 
 namespace xlux {
 
+namespace {
+
+// Snaps where the line through an edge with an end out of range enters and
+// leaves the range. Sliding the ends along the line keeps every pixel on its
+// side. The line is found from exact products of the ends, which both
+// triangles sharing the edge get the same up to the sign. Returns false when
+// the line misses the range.
+Bool SnapEdgeLine(const math::Vec4& from, const math::Vec4& to, I64* xs,
+                  I64* ys) {
+  const F64 dx = F64(to[0]) - from[0];
+  const F64 dy = F64(to[1]) - from[1];
+  // the points (x, y) of the line are those with dx * y - dy * x == k
+  const F64 k = F64(to[0]) * from[1] - F64(from[0]) * to[1];
+
+  F64 tMin = std::numeric_limits<F64>::infinity();
+  F64 tMax = -std::numeric_limits<F64>::infinity();
+  F64 first[2] = {}, last[2] = {};
+  auto addCrossing = [&](F64 x, F64 y) {
+    if (!(std::abs(x) <= k_MaxFixedCoordinate &&
+          std::abs(y) <= k_MaxFixedCoordinate)) {
+      return;
+    }
+    // along the edge
+    const F64 t = dx * x + dy * y;
+    if (t < tMin) {
+      tMin = t;
+      first[0] = x;
+      first[1] = y;
+    }
+    if (t > tMax) {
+      tMax = t;
+      last[0] = x;
+      last[1] = y;
+    }
+  };
+  for (const F64 side : {-k_MaxFixedCoordinate, k_MaxFixedCoordinate}) {
+    if (dx != 0.0) addCrossing(side, (k + dy * side) / dx);
+    if (dy != 0.0) addCrossing((dx * side - k) / dy, side);
+  }
+  if (!(tMin < tMax)) return false;
+
+  xs[0] = static_cast<I64>(std::round(first[0] * k_SubPixelScale));
+  ys[0] = static_cast<I64>(std::round(first[1] * k_SubPixelScale));
+  xs[1] = static_cast<I64>(std::round(last[0] * k_SubPixelScale));
+  ys[1] = static_cast<I64>(std::round(last[1] * k_SubPixelScale));
+  return xs[0] != xs[1] || ys[0] != ys[1];
+}
+
+}  // namespace
+
 // follows top-left rule
 Bool FragmentShaderWorker::PointInTriangle(const math::Vec2& p,
-                                           const math::Vec4& p0,
+                                           const FixedEdgeFunction* edges) {
+  const auto x = static_cast<I64>(p[0]);
+  const auto y = static_cast<I64>(p[1]);
+  return edges[0].Evaluate(x, y) > 0 && edges[1].Evaluate(x, y) > 0 &&
+         edges[2].Evaluate(x, y) > 0;
+}
+
+Bool FragmentShaderWorker::SetupFixedEdges(const math::Vec4& p0,
                                            const math::Vec4& p1,
-                                           const math::Vec4& p2) {
-  const auto p0o = math::Vec2(p0[0], p0[1]);
-  const auto p1o = math::Vec2(p1[0], p1[1]);
-  const auto p2o = math::Vec2(p2[0], p2[1]);
-  const auto po = math::Vec2(p[0], p[1]);
-
-  const auto d1 = (p1o[0] - p0o[0]) * (po[1] - p0o[1]) -
-                  (po[0] - p0o[0]) * (p1o[1] - p0o[1]);
-  const auto d2 = (p2o[0] - p1o[0]) * (po[1] - p1o[1]) -
-                  (po[0] - p1o[0]) * (p2o[1] - p1o[1]);
-  const auto d3 = (p0o[0] - p2o[0]) * (po[1] - p2o[1]) -
-                  (po[0] - p2o[0]) * (p0o[1] - p2o[1]);
-
-  const auto BIAS = 0.00000f;
-  return ((d1 > -BIAS) && (d2 > -BIAS) &&
-          (d3 > -BIAS));  // || ((d1 < BIAS) && (d2 < BIAS) && (d3 < BIAS));
+                                           const math::Vec4& p2,
+                                           FixedEdgeFunction* edges) {
+  const RawPtr<const math::Vec4> points[3] = {&p0, &p1, &p2};
+  for (const auto point : points) {
+    if (!std::isfinite((*point)[0]) || !std::isfinite((*point)[1])) {
+      return false;
+    }
+  }
+
+  I64 xs[3], ys[3];
+  Bool isInRange[3];
+  for (U32 i = 0; i < 3; ++i) {
+    isInRange[i] =
+        ToFixed((*points[i])[0], xs[i]) && ToFixed((*points[i])[1], ys[i]);
+  }
+
+  // twice the signed area, only counter clockwise triangles are rasterized
+  if (isInRange[0] && isInRange[1] && isInRange[2]) {
+    const I64 area =
+        (xs[1] - xs[0]) * (ys[2] - ys[0]) - (xs[2] - xs[0]) * (ys[1] - ys[0]);
+    if (area <= 0) return false;
+  } else {
+    const F64 area = (F64(p1[0]) - p0[0]) * (F64(p2[1]) - p0[1]) -
+                     (F64(p2[0]) - p0[0]) * (F64(p1[1]) - p0[1]);
+    if (area <= 0.0) return false;
+  }
+
+  for (U32 i = 0; i < 3; ++i) {
+    // the edge opposite to vertex i, like EdgeFunction
+    const U32 from = (i + 1) % 3, to = (i + 2) % 3;
+    I64 edgeXs[2] = {xs[from], xs[to]};
+    I64 edgeYs[2] = {ys[from], ys[to]};
+    if ((!isInRange[from] || !isInRange[to]) &&
+        !SnapEdgeLine(*points[from], *points[to], edgeXs, edgeYs)) {
+      // The range, and with it the framebuffer, lies on one side of the
+      // edge. It covers everything when that is the inner side.
+      const auto& fromPoint = *points[from];
+      const auto& toPoint = *points[to];
+      if (F64(toPoint[0]) * fromPoint[1] - F64(toPoint[1]) * fromPoint[0] >=
+          0.0) {
+        return false;
+      }
+      edges[i].a = 0;
+      edges[i].b = 0;
+      edges[i].c = 1;
+      continue;
+    }
+
+    const I64 fromX = edgeXs[0], fromY = edgeYs[0];
+    const I64 toX = edgeXs[1], toY = edgeYs[1];
+    const I64 a = fromY - toY;
+    const I64 b = toX - fromX;
+
+    // Left edges (and, with y pointing up here, the edges at the top of the
+    // framebuffer) own the pixels lying exactly on them.
+    const Bool isTopLeft = a > 0 || (a == 0 && b > 0);
+
+    // At sample (x, y) * scale the exact edge value is
+    //   E = scale * (a * x + b * y) - (a * fromX + b * fromY)
+    // and the pixel is inside when E + bias > 0. As a * x + b * y is an
+    // integer this is the same as a * x + b * y + c > 0 with
+    //   c = -floor((a * fromX + b * fromY - bias) / scale).
+    const I64 bias = isTopLeft ? 1 : 0;
+    const I64 numerator = a * fromX + b * fromY - bias;
+    const I64 quotient = numerator / k_SubPixelScale;
+    const I64 floored =
+        quotient - ((numerator % k_SubPixelScale) < 0 ? 1 : 0);
+
+    edges[i].a = a;
+    edges[i].b = b;
+    edges[i].c = -floored;
+  }
+
+  return true;
 }
 
 math::Vec3 FragmentShaderWorker::CalculateBarycentric(const math::Vec2& p,
@@ -52,41 +172,431 @@ math::Vec3 FragmentShaderWorker::CalculateBarycentric(const math::Vec2& p,
   return math::Vec3(w, v, u);
 }
 
+void AttributePlanes::Setup(const ShaderTriangleRef& triangle) {
+  const auto& p0 = triangle.GetBuiltInRef(0)->Position;
+  const auto& p1 = triangle.GetBuiltInRef(1)->Position;
+  const auto& p2 = triangle.GetBuiltInRef(2)->Position;
+
+  // solve the plane through the three vertices relative to the first one
+  const F32 e1x = p1[0] - p0[0], e1y = p1[1] - p0[1];
+  const F32 e2x = p2[0] - p0[0], e2y = p2[1] - p0[1];
+  const F32 invDeterminant = 1.0f / (e1x * e2y - e2x * e1y);
+
+  const auto v0 = reinterpret_cast<const F32*>(triangle.GetVertexData(0));
+  const auto v1 = reinterpret_cast<const F32*>(triangle.GetVertexData(1));
+  const auto v2 = reinterpret_cast<const F32*>(triangle.GetVertexData(2));
+
+  x0 = p0[0];
+  y0 = p0[1];
+  for (U32 i = 0; i < componentCount; ++i) {
+    const F32 d1 = v1[i] - v0[i];
+    const F32 d2 = v2[i] - v0[i];
+    origin[i] = v0[i];
+    ddx[i] = (d1 * e2y - d2 * e1y) * invDeterminant;
+    ddy[i] = (d2 * e1x - d1 * e2x) * invDeterminant;
+  }
+
+  isReady = true;
+}
+
+void FragmentShaderWorker::RunTask(RawPtr<void> context, U64 argument,
+                                   U32 threadID) {
+  auto payload =
+      *reinterpret_cast<RawPtr<const FragmentShaderWorkerInput>>(context);
+  payload.slotId = static_cast<U32>(argument);
+
+  if (argument & FragmentShaderWorkerInput::k_ClearTileBit) {
+    const auto framebuffer = payload.framebuffer;
+    const auto height = static_cast<U32>(framebuffer->GetHeight());
+    const auto tileOffset = framebuffer->GetTileOffset(payload.slotId);
+    const auto tileSize = framebuffer->GetTileSize();
+    const auto tileEndX = std::min(tileOffset.x + tileSize.x,
+                                   static_cast<U32>(framebuffer->GetWidth()));
+    const auto tileEndY = std::min(tileOffset.y + tileSize.y, height);
+    FrameClearWorker::ClearRegion(
+        *payload.clear,
+        MakePair(std::max(tileOffset.x, payload.clearStart.x),
+                 std::max(height - tileEndY, payload.clearStart.y)),
+        MakePair(std::min(tileEndX, payload.clearEnd.x),
+                 std::min(height - tileOffset.y, payload.clearEnd.y)));
+  }
+
+  if (payload.binner) {
+    FragmentShaderWorker worker;
+    worker.Execute(payload, threadID);
+  }
+}
+
 Bool FragmentShaderWorker::Execute(FragmentShaderWorkerInput payload,
                                    U32 threadID) {
   (void)threadID;
 
-  auto tileOffset = payload.framebuffer->GetTileOffset(payload.slotId);
-  auto tileSize = payload.framebuffer->GetTileSize();
-  auto tileEnd = MakePair(std::clamp(tileOffset.x + tileSize.x, 0U,
-                                     (U32)payload.framebuffer->GetWidth()),
-                          std::clamp(tileOffset.y + tileSize.y, 0U,
-                                     (U32)payload.framebuffer->GetHeight()));
-
-  auto boundingBox = payload.triangle.GetBoundingBox();
-  tileOffset.x = std::max(
-      tileOffset.x, static_cast<U32>(std::max(0.0f, boundingBox[0] - 1.0f)));
-  tileOffset.y = std::max(
-      tileOffset.y, static_cast<U32>(std::max(0.0f, boundingBox[1] - 1.0f)));
-  tileEnd.x = std::min(tileEnd.x,
-                       static_cast<U32>(std::max(0.0f, boundingBox[2] + 1.0f)));
-  tileEnd.y = std::min(tileEnd.y,
-                       static_cast<U32>(std::max(0.0f, boundingBox[3] + 1.0f)));
-
-  auto interpolator = payload.pipeline->m_CreateInfo.interpolator;
-  auto framebuffer = payload.framebuffer;
-
-  U32 currentSlotOwner = 0;
-  while (!framebuffer->AcquireSlot(payload.slotId, threadID + 1,
-                                   currentSlotOwner));
-
-  FragmentShaderOutput fragmentShaderOutput = {};
+  // Tiles are handed out to exactly one worker per dispatch, so the tile can
+  // be written without acquiring its framebuffer slot.
+  const auto tileOffset = payload.framebuffer->GetTileOffset(payload.slotId);
+  const auto tileSize = payload.framebuffer->GetTileSize();
+  const auto tileEnd = MakePair(
+      std::clamp(tileOffset.x + tileSize.x, 0U,
+                 (U32)payload.framebuffer->GetWidth()),
+      std::clamp(tileOffset.y + tileSize.y, 0U,
+                 (U32)payload.framebuffer->GetHeight()));
+
   U8 fragmentInterpolatedInput[1024];
 
-  auto& p0 = payload.triangle.GetBuiltInRef(0)->Position;
-  auto& p1 = payload.triangle.GetBuiltInRef(1)->Position;
-  auto& p2 = payload.triangle.GetBuiltInRef(2)->Position;
-  auto vertexData = payload.triangle.GetVertexData();
+  const Bool hasHierarchicalDepth =
+      payload.framebuffer->HasHierarchicalDepth();
+
+  AttributePlanes attributePlanes;
+
+  payload.binner->ForEachInOrder(payload.slotId, [&](const BinnedTriangle&
+                                                         binned) {
+    FragmentShaderTriangleInput input = {
+        .triangle = binned.triangle,
+        .pipeline = binned.pipeline,
+        .framebuffer = payload.framebuffer,
+    };
+    const auto& createInfo = input.pipeline->m_CreateInfo;
+
+    const auto componentCount =
+        createInfo.interpolator->GetLinearComponentCount();
+    if (componentCount > 0 &&
+        componentCount <= AttributePlanes::k_MaxComponentCount) {
+      attributePlanes.componentCount = static_cast<U32>(componentCount);
+      attributePlanes.isReady = false;
+      input.attributePlanes = &attributePlanes;
+    }
+
+    // clamped to the tile before the conversion, far positions do not fit
+    // into a U32
+    auto toPixel = [](F32 value, U32 low, U32 high) {
+      return value > F32(low) ? static_cast<U32>(std::min(value, F32(high)))
+                              : low;
+    };
+    auto boundingBox = input.triangle.GetBoundingBox();
+    auto regionOffset =
+        MakePair(toPixel(boundingBox[0] - 1.0f, tileOffset.x, tileEnd.x),
+                 toPixel(boundingBox[1] - 1.0f, tileOffset.y, tileEnd.y));
+    auto regionEnd =
+        MakePair(toPixel(boundingBox[2] + 1.0f, tileOffset.x, tileEnd.x),
+                 toPixel(boundingBox[3] + 1.0f, tileOffset.y, tileEnd.y));
+
+    if (regionOffset.x >= regionEnd.x || regionOffset.y >= regionEnd.y) {
+      return;
+    }
+
+    if (hasHierarchicalDepth && createInfo.depthTestEnable) {
+      switch (createInfo.depthCompareFunction) {
+        case CompareFunction_Less:
+        case CompareFunction_LessEqual: {
+          // the stored depth only ever decreases here, a depth written by
+          // the shader is not known up front though
+          if (createInfo.fragmentShaderWritesDepth) break;
+
+          const auto nearestDepth =
+              std::min({input.triangle.GetBuiltInRef(0)->Position[2],
+                        input.triangle.GetBuiltInRef(1)->Position[2],
+                        input.triangle.GetBuiltInRef(2)->Position[2]});
+          if (IsOccluded(nearestDepth,
+                         payload.framebuffer->GetTileMaxDepth(payload.slotId),
+                         createInfo.depthCompareFunction)) {
+            return;
+          }
+          input.useHierarchicalDepth = true;
+          break;
+        }
+        case CompareFunction_Never:
+        case CompareFunction_Equal: {
+          break;
+        }
+        default: {
+          payload.framebuffer->InvalidateTileMaxDepth(payload.slotId);
+          break;
+        }
+      }
+    }
+
+    // keep the blocks of the rasterizer aligned to the hierarchical depth
+    // blocks of the tile
+    regionOffset.x -=
+        (regionOffset.x - tileOffset.x) % IFramebuffer::k_HiZBlockSize;
+    regionOffset.y -=
+        (regionOffset.y - tileOffset.y) % IFramebuffer::k_HiZBlockSize;
+
+    switch (createInfo.rasterizerMode) {
+      case RasterizerMode_Barycentric: {
+        RasterizeBarycentric(input, regionOffset, regionEnd,
+                             fragmentInterpolatedInput);
+        break;
+      }
+      case RasterizerMode_EdgeFunction:
+      default: {
+        if (RasterizeEdgeFunction(input, regionOffset, regionEnd,
+                                  fragmentInterpolatedInput)) {
+          payload.framebuffer->UpdateTileMaxDepth(payload.slotId);
+        }
+        break;
+      }
+    }
+  });
+
+  return false;
+}
+
+Bool FragmentShaderWorker::RasterizeEdgeFunction(
+    const FragmentShaderTriangleInput& input, const Pair<U32, U32>& tileOffset,
+    const Pair<U32, U32>& tileEnd, RawPtr<U8> interpolatedInput) {
+  const auto& p0 = input.triangle.GetBuiltInRef(0)->Position;
+  const auto& p1 = input.triangle.GetBuiltInRef(1)->Position;
+  const auto& p2 = input.triangle.GetBuiltInRef(2)->Position;
+
+  // Each edge is the one opposite to the vertex with the same index, so its
+  // value at a pixel is the (unnormalized) barycentric weight of that vertex.
+  const EdgeFunction edges[3] = {EdgeFunction(p1, p2), EdgeFunction(p2, p0),
+                                 EdgeFunction(p0, p1)};
+
+  // coverage is decided on the fixed point edges, the float ones only give
+  // the barycentrics
+  FixedEdgeFunction fixedEdges[3];
+  if (!SetupFixedEdges(p0, p1, p2, fixedEdges)) return false;
+
+  const F32 area = edges[2].Evaluate(p2[0], p2[1]);
+  const F32 invArea = 1.0f / area;
+
+  auto framebuffer = input.framebuffer;
+  const auto& createInfo = input.pipeline->m_CreateInfo;
+  const Bool testDepth =
+      createInfo.depthTestEnable && framebuffer->HasDepthAttachment();
+  const Bool testDepthEarly =
+      testDepth && !createInfo.fragmentShaderWritesDepth;
+
+  using math::F32x8;
+  const auto laneOffsets = F32x8::Ramp(0.0f);
+  const F32x8 edgeStepX[3] = {F32x8::Splat(edges[0].a * F32x8::k_Width),
+                              F32x8::Splat(edges[1].a * F32x8::k_Width),
+                              F32x8::Splat(edges[2].a * F32x8::k_Width)};
+  const F32x8 edgeLaneX[3] = {laneOffsets * F32x8::Splat(edges[0].a),
+                              laneOffsets * F32x8::Splat(edges[1].a),
+                              laneOffsets * F32x8::Splat(edges[2].a)};
+  const auto invArea8 = F32x8::Splat(invArea);
+
+  // Each lane group starts from its exact 64 bit edge value, clamped into
+  // 32 bits without changing the sign of any lane, and adds the lane steps.
+  using math::I32x8;
+  constexpr I64 k_MaxLaneBase = I64(1) << 30;
+  const auto zero = I32x8::Splat(0);
+  I32x8 fixedLaneX[3];
+  for (U32 i = 0; i < 3; ++i) {
+    I32 steps[I32x8::k_Width];
+    for (U32 lane = 0; lane < I32x8::k_Width; ++lane) {
+      steps[lane] = static_cast<I32>(fixedEdges[i].a * lane);
+    }
+    fixedLaneX[i] = I32x8::Load(steps);
+  }
+  auto fixedLanes = [&](U32 i, I64 value) {
+    return I32x8::Splat(static_cast<I32>(
+               std::clamp(value, -k_MaxLaneBase, k_MaxLaneBase))) +
+           fixedLaneX[i];
+  };
+
+  F32 barycentrics[3][F32x8::k_Width];
+  F32 depths[F32x8::k_Width];
+  F32 currentDepths[F32x8::k_Width] = {};
+  FragmentShaderOutput outputs[F32x8::k_Width];
+
+  auto shadeLanes = [&](U32 x, U32 y, U32 fy, U32 coverage,
+                        const F32x8& w0, const F32x8& w1, const F32x8& w2) {
+    const auto b0 = w0 * invArea8;
+    const auto b1 = w1 * invArea8;
+    const auto b2 = w2 * invArea8;
+    b0.Store(barycentrics[0]);
+    b1.Store(barycentrics[1]);
+    b2.Store(barycentrics[2]);
+    (b0 * F32x8::Splat(p0[2]) + b1 * F32x8::Splat(p1[2]) +
+     b2 * F32x8::Splat(p2[2]))
+        .Store(depths);
+
+    auto depthTest = [&](U32 mask) {
+      for (U32 bits = mask; bits; bits &= bits - 1) {
+        const auto lane = static_cast<U32>(std::countr_zero(bits));
+        framebuffer->GetDepthPixel(x + lane, fy, currentDepths[lane]);
+      }
+
+      mask &= CompareDepthLanes(depths, currentDepths,
+                                createInfo.depthCompareFunction);
+
+      for (U32 bits = mask; bits; bits &= bits - 1) {
+        const auto lane = static_cast<U32>(std::countr_zero(bits));
+        framebuffer->WriteDepthPixel(x + lane, fy, depths[lane]);
+      }
+      return mask;
+    };
+
+    U32 survivors = coverage;
+    if (testDepthEarly) {
+      survivors = depthTest(survivors);
+      if (!survivors) return survivors;
+    }
+
+    FragmentBatch batch = {
+        .interpolatedInput = interpolatedInput,
+        .x = x,
+        .y = y,
+        .mask = survivors,
+        .barycentrics = {barycentrics[0], barycentrics[1], barycentrics[2]},
+        .depths = depths,
+        .writesDepth = !testDepthEarly,
+        .outputs = outputs,
+    };
+    ShadeFragments(batch, input);
+
+    if (testDepth && !testDepthEarly) {
+      survivors = depthTest(survivors);
+    }
+
+    for (U32 bits = survivors; bits; bits &= bits - 1) {
+      const auto lane = static_cast<U32>(std::countr_zero(bits));
+      BlendAndApplyColor(x + lane, fy, framebuffer, input.pipeline,
+                         outputs[lane]);
+    }
+    return survivors;
+  };
+
+  // depth over the triangle plane, z = E0 * z0 + E1 * z1 + E2 * z2 / area
+  auto planeDepth = [&](F32 x, F32 y) {
+    return (edges[0].Evaluate(x, y) * p0[2] + edges[1].Evaluate(x, y) * p1[2] +
+            edges[2].Evaluate(x, y) * p2[2]) *
+           invArea;
+  };
+  // only the signs of the depth slopes are needed, area is positive
+  const F32 depthSlopeX =
+      edges[0].a * p0[2] + edges[1].a * p1[2] + edges[2].a * p2[2];
+  const F32 depthSlopeY =
+      edges[0].b * p0[2] + edges[1].b * p1[2] + edges[2].b * p2[2];
+  const F32 triangleMinDepth = std::min({p0[2], p1[2], p2[2]});
+  const F32 triangleMaxDepth = std::max({p0[2], p1[2], p2[2]});
+  Bool isHierarchicalDepthLowered = false;
+
+  // blocks are kept a multiple of the lane width so that every lane group
+  // lies entirely within a single block
+  const U32 blockSize =
+      createInfo.rasterizerBlockSize == 0
+          ? std::max(tileEnd.x - tileOffset.x, tileEnd.y - tileOffset.y)
+          : createInfo.rasterizerBlockSize;
+  const U32 blockSizeX =
+      std::max<U32>(1u, (blockSize + F32x8::k_Width - 1) / F32x8::k_Width) *
+      F32x8::k_Width;
+  const U32 blockSizeY = std::max(1u, blockSize);
+
+  for (U32 blockY = tileOffset.y; blockY < tileEnd.y; blockY += blockSizeY) {
+    const U32 blockEndY = std::min(blockY + blockSizeY, tileEnd.y);
+
+    for (U32 blockX = tileOffset.x; blockX < tileEnd.x; blockX += blockSizeX) {
+      const U32 blockEndX = std::min(blockX + blockSizeX, tileEnd.x);
+
+      // The edge functions are linear, so their extremes over the block are
+      // found at the corners of its pixel grid. A block is rejected when it
+      // lies fully outside any edge and trivially accepted when it lies fully
+      // inside all three.
+      const auto minX = static_cast<F32>(blockX);
+      const auto minY = static_cast<F32>(blockY);
+      const auto maxX = static_cast<F32>(blockEndX - 1);
+      const auto maxY = static_cast<F32>(blockEndY - 1);
+
+      Bool isOutside = false;
+      Bool isInside = true;
+      for (const auto& edge : fixedEdges) {
+        const I64 low = edge.Evaluate(edge.a >= 0 ? blockX : blockEndX - 1,
+                                      edge.b >= 0 ? blockY : blockEndY - 1);
+        const I64 high = edge.Evaluate(edge.a >= 0 ? blockEndX - 1 : blockX,
+                                       edge.b >= 0 ? blockEndY - 1 : blockY);
+        isOutside |= (high <= 0);
+        isInside &= (low > 0);
+      }
+
+      if (isOutside) continue;
+
+      // Bounds of the triangle depth over the block, the plane is extended
+      // to the whole block so it is also clamped to the triangle depth range.
+      F32 blockMinDepth = 0.0f;
+      F32 blockMaxDepth = 0.0f;
+      if (input.useHierarchicalDepth) {
+        blockMinDepth = std::max(
+            triangleMinDepth, planeDepth(depthSlopeX >= 0.0f ? minX : maxX,
+                                         depthSlopeY >= 0.0f ? minY : maxY));
+        blockMaxDepth = std::min(
+            triangleMaxDepth, planeDepth(depthSlopeX >= 0.0f ? maxX : minX,
+                                         depthSlopeY >= 0.0f ? maxY : minY));
+
+        if (IsOccluded(blockMinDepth,
+                       framebuffer->GetBlockMaxDepth(blockX, blockY, blockEndX,
+                                                     blockEndY),
+                       createInfo.depthCompareFunction)) {
+          continue;
+        }
+      }
+
+      U32 rejected = 0;
+      const auto startX = static_cast<F32>(blockX);
+      for (U32 y = blockY; y < blockEndY; ++y) {
+        const auto py = static_cast<F32>(y);
+        F32x8 w0 = F32x8::Splat(edges[0].Evaluate(startX, py)) + edgeLaneX[0];
+        F32x8 w1 = F32x8::Splat(edges[1].Evaluate(startX, py)) + edgeLaneX[1];
+        F32x8 w2 = F32x8::Splat(edges[2].Evaluate(startX, py)) + edgeLaneX[2];
+
+        I64 e0 = fixedEdges[0].Evaluate(blockX, y);
+        I64 e1 = fixedEdges[1].Evaluate(blockX, y);
+        I64 e2 = fixedEdges[2].Evaluate(blockX, y);
+
+        const auto fy = framebuffer->GetHeight() - 1 - y;
+
+        for (U32 x = blockX; x < blockEndX; x += F32x8::k_Width) {
+          U32 coverage = F32x8::k_FullMask;
+          if (blockEndX - x < F32x8::k_Width) {
+            coverage = (1u << (blockEndX - x)) - 1u;
+          }
+
+          if (!isInside) {
+            coverage &= (fixedLanes(0, e0).Greater(zero) &
+                         fixedLanes(1, e1).Greater(zero) &
+                         fixedLanes(2, e2).Greater(zero))
+                            .MoveMask();
+          }
+
+          if (coverage) {
+            rejected |=
+                coverage & ~shadeLanes(x, y, fy, coverage, w0, w1, w2);
+          }
+
+          w0 += edgeStepX[0];
+          w1 += edgeStepX[1];
+          w2 += edgeStepX[2];
+          e0 += fixedEdges[0].a * F32x8::k_Width;
+          e1 += fixedEdges[1].a * F32x8::k_Width;
+          e2 += fixedEdges[2].a * F32x8::k_Width;
+        }
+      }
+
+      // every pixel of the block now holds a depth from this triangle
+      if (input.useHierarchicalDepth && isInside && !rejected) {
+        framebuffer->LowerBlockMaxDepth(blockX, blockY, blockEndX, blockEndY,
+                                        blockMaxDepth);
+        isHierarchicalDepthLowered = true;
+      }
+    }
+  }
+
+  return isHierarchicalDepthLowered;
+}
+
+void FragmentShaderWorker::RasterizeBarycentric(
+    const FragmentShaderTriangleInput& input, const Pair<U32, U32>& tileOffset,
+    const Pair<U32, U32>& tileEnd, RawPtr<U8> interpolatedInput) {
+  const auto& p0 = input.triangle.GetBuiltInRef(0)->Position;
+  const auto& p1 = input.triangle.GetBuiltInRef(1)->Position;
+  const auto& p2 = input.triangle.GetBuiltInRef(2)->Position;
+
+  FixedEdgeFunction edges[3];
+  if (!SetupFixedEdges(p0, p1, p2, edges)) return;
 
   for (U32 y = tileOffset.y; y < tileEnd.y; ++y) {
     for (U32 x = tileOffset.x; x < tileEnd.x; ++x) {
@@ -94,37 +604,142 @@ Bool FragmentShaderWorker::Execute(FragmentShaderWorkerInput payload,
       // auto p = math::Vec2((F32)x / framebuffer->GetWidth(), (F32)y /
       // framebuffer->GetHeight());
 
-      if (PointInTriangle(p, p0, p1, p2)) {
-        auto baycentric = CalculateBarycentric(p, p0, p1, p2);
-        interpolator->Reset(fragmentInterpolatedInput);
-
-        interpolator->ScaleAndAdd(fragmentInterpolatedInput, vertexData[0],
-                                  baycentric[0]);
-        interpolator->ScaleAndAdd(fragmentInterpolatedInput, vertexData[1],
-                                  baycentric[1]);
-        interpolator->ScaleAndAdd(fragmentInterpolatedInput, vertexData[2],
-                                  baycentric[2]);
-
-        fragmentShaderOutput.Depth = p0[2] * baycentric[0] +
-                                     p1[2] * baycentric[1] +
-                                     p2[2] * baycentric[2];
-        payload.pipeline->m_CreateInfo.fragmentShader->Execute(
-            fragmentInterpolatedInput, &fragmentShaderOutput);
-
-        auto px = x, py = framebuffer->GetHeight() - 1 - y;
-
-        if (BlendAndApplyDepth(px, py, framebuffer, payload.pipeline,
-                               fragmentShaderOutput.Depth)) {
-          BlendAndApplyColor(px, py, framebuffer, payload.pipeline,
-                             fragmentShaderOutput);
-        }
+      if (PointInTriangle(p, edges)) {
+        ShadeFragment(x, y, CalculateBarycentric(p, p0, p1, p2), input,
+                      interpolatedInput);
       }
     }
   }
+}
 
-  framebuffer->ReleaseSlot(payload.slotId);
+void FragmentShaderWorker::ShadeFragment(
+    U32 x, U32 y, const math::Vec3& barycentric,
+    const FragmentShaderTriangleInput& input, RawPtr<U8> interpolatedInput) {
+  auto framebuffer = input.framebuffer;
 
-  return false;
+  const auto& p0 = input.triangle.GetBuiltInRef(0)->Position;
+  const auto& p1 = input.triangle.GetBuiltInRef(1)->Position;
+  const auto& p2 = input.triangle.GetBuiltInRef(2)->Position;
+
+  const auto& createInfo = input.pipeline->m_CreateInfo;
+  const F32 depth =
+      p0[2] * barycentric[0] + p1[2] * barycentric[1] + p2[2] * barycentric[2];
+
+  auto px = x, py = framebuffer->GetHeight() - 1 - y;
+
+  // without depth writes from the shader the interpolated depth is final,
+  // so occluded fragments can be rejected before doing any work for them
+  const Bool testDepthEarly = !createInfo.fragmentShaderWritesDepth;
+  if (testDepthEarly &&
+      !BlendAndApplyDepth(px, py, framebuffer, input.pipeline, depth)) {
+    return;
+  }
+
+  const F32 barycentrics[3] = {barycentric[0], barycentric[1],
+                               barycentric[2]};
+  F32 fragmentDepth = depth;
+  FragmentShaderOutput fragmentShaderOutput;
+  FragmentBatch batch = {
+      .interpolatedInput = interpolatedInput,
+      .x = x,
+      .y = y,
+      .mask = 1u,
+      .barycentrics = {&barycentrics[0], &barycentrics[1], &barycentrics[2]},
+      .depths = &fragmentDepth,
+      .writesDepth = !testDepthEarly,
+      .outputs = &fragmentShaderOutput,
+  };
+  ShadeFragments(batch, input);
+
+  if (testDepthEarly || BlendAndApplyDepth(px, py, framebuffer,
+                                           input.pipeline, fragmentDepth)) {
+    BlendAndApplyColor(px, py, framebuffer, input.pipeline,
+                       fragmentShaderOutput);
+  }
+}
+
+void FragmentShaderWorker::ShadeFragments(
+    FragmentBatch& batch, const FragmentShaderTriangleInput& input) {
+  const auto& createInfo = input.pipeline->m_CreateInfo;
+  batch.shader = createInfo.fragmentShader;
+  batch.interpolator = createInfo.interpolator;
+  batch.triangle = &input.triangle;
+  batch.attributePlanes = input.attributePlanes;
+
+  if (createInfo.fragmentShadeFunction) {
+    createInfo.fragmentShadeFunction(batch);
+  } else {
+    ShadeFragmentsGeneric(batch);
+  }
+}
+
+void FragmentShaderWorker::ShadeFragmentsGeneric(FragmentBatch& batch) {
+  auto planes = batch.attributePlanes;
+  if (planes && !planes->isReady) planes->Setup(*batch.triangle);
+
+  for (U32 bits = batch.mask; bits; bits &= bits - 1) {
+    const auto lane = static_cast<U32>(std::countr_zero(bits));
+
+    if (planes) {
+      planes->Evaluate(static_cast<F32>(batch.x + lane),
+                       static_cast<F32>(batch.y),
+                       reinterpret_cast<RawPtr<F32>>(batch.interpolatedInput));
+    } else {
+      batch.interpolator->Reset(batch.interpolatedInput);
+      for (U32 i = 0; i < 3; ++i) {
+        batch.interpolator->ScaleAndAdd(batch.interpolatedInput,
+                                        batch.triangle->GetVertexData(i),
+                                        batch.barycentrics[i][lane]);
+      }
+    }
+
+    auto& output = batch.outputs[lane];
+    output = FragmentShaderOutput();
+    output.Depth = batch.depths[lane];
+    batch.shader->Execute(batch.interpolatedInput, &output);
+    if (batch.writesDepth) batch.depths[lane] = output.Depth;
+  }
+}
+
+U32 FragmentShaderWorker::CompareDepthLanes(
+    const F32* depths, const F32* currentDepths,
+    ECompareFunction compareFunction) {
+  using math::F32x8;
+  const auto depth = F32x8::Load(depths);
+  const auto currentDepth = F32x8::Load(currentDepths);
+
+  switch (compareFunction) {
+    case CompareFunction_Never:
+      return 0u;
+    case CompareFunction_Less:
+      return depth.Less(currentDepth).MoveMask();
+    case CompareFunction_Equal:
+      return depth.Equal(currentDepth).MoveMask();
+    case CompareFunction_LessEqual:
+      return depth.LessEqual(currentDepth).MoveMask();
+    case CompareFunction_Greater:
+      return depth.Greater(currentDepth).MoveMask();
+    case CompareFunction_NotEqual:
+      return depth.NotEqual(currentDepth).MoveMask();
+    case CompareFunction_GreaterEqual:
+      return depth.GreaterEqual(currentDepth).MoveMask();
+    case CompareFunction_Always:
+      return F32x8::k_FullMask;
+    default:
+      return 0u;
+  }
+}
+
+Bool FragmentShaderWorker::IsOccluded(F32 nearestDepth, F32 maxDepth,
+                                      ECompareFunction compareFunction) {
+  switch (compareFunction) {
+    case CompareFunction_Less:
+      return nearestDepth >= maxDepth;
+    case CompareFunction_LessEqual:
+      return nearestDepth > maxDepth;
+    default:
+      return false;
+  }
 }
 
 Bool FragmentShaderWorker::BlendAndApplyDepth(U32 px, U32 py,
@@ -187,7 +802,7 @@ Bool FragmentShaderWorker::BlendAndApplyDepth(U32 px, U32 py,
       break;
     }
   }
-  if (testResult) framebuffer->SetDepthPixel(px, py, depth);
+  if (testResult) framebuffer->WriteDepthPixel(px, py, depth);
   return testResult;
 }
 
@@ -4,19 +4,13 @@
 #include "Impl/Framebuffer.hpp"
 
 namespace xlux {
-Bool FrameClearWorker::Execute(FrameClearWorkerInput payload, U32 threadID) {
-  (void)threadID;
-
-  auto tileOffset = payload.framebuffer->GetTileOffset(payload.slotId);
-  auto tileSize = payload.framebuffer->GetTileSize();
-  auto tileEnd = MakePair(std::clamp(tileOffset.x + tileSize.x, 0U,
-                                     (U32)payload.framebuffer->GetWidth()),
-                          std::clamp(tileOffset.y + tileSize.y, 0U,
-                                     (U32)payload.framebuffer->GetHeight()));
+void FrameClearWorker::ClearRegion(const FrameClearWorkerInput& payload,
+                                   const Pair<U32, U32>& start,
+                                   const Pair<U32, U32>& end) {
   auto pixel = payload.clearColor.ToVec4();
 
-  for (U32 x = tileOffset.x; x < tileEnd.x; ++x) {
-    for (U32 y = tileOffset.y; y < tileEnd.y; ++y) {
+  for (U32 x = start.x; x < end.x; ++x) {
+    for (U32 y = start.y; y < end.y; ++y) {
       if (payload.shouldClearColor) {
         for (U32 ch = 0; ch < payload.framebuffer->GetColorAttachmentCount();
              ++ch) {
@@ -27,12 +21,10 @@ Bool FrameClearWorker::Execute(FrameClearWorkerInput payload, U32 threadID) {
 
       if (payload.shouldClearDepth &&
           payload.framebuffer->HasDepthAttachment()) {
-        payload.framebuffer->SetDepthPixel(x, y, 10000000.0f);
+        payload.framebuffer->WriteDepthPixel(x, y, k_ClearDepth);
       }
     }
   }
-
-  return false;
 }
 
 }  // namespace xlux
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "Impl/Meshlet.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace xlux {
+
+List<Meshlet> BuildMeshlets(const U32* indices, U32 indexCount,
+                            const void* positions, Size positionStride,
+                            List<U32>& meshletIndices, U32 maxVertices,
+                            U32 maxTriangles) {
+  List<Meshlet> meshlets;
+  meshletIndices.clear();
+  const auto triangleCount = indexCount / 3;
+  if (triangleCount == 0 || maxVertices < 3 || maxTriangles == 0) {
+    return meshlets;
+  }
+  meshletIndices.reserve(triangleCount * 3);
+
+  auto getPosition = [&](U32 index) {
+    const auto position = reinterpret_cast<const F32*>(
+        static_cast<const U8*>(positions) + index * positionStride);
+    return math::Vec3(position[0], position[1], position[2]);
+  };
+
+  // the triangles around every vertex
+  const auto vertexCount =
+      *std::max_element(indices, indices + triangleCount * 3) + 1;
+  List<U32> adjacencyOffsets(vertexCount + 1, 0);
+  for (U32 i = 0; i < triangleCount * 3; ++i) {
+    ++adjacencyOffsets[indices[i] + 1];
+  }
+  for (U32 i = 0; i < vertexCount; ++i) {
+    adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+  }
+  List<U32> adjacency(triangleCount * 3);
+  {
+    auto offsets = adjacencyOffsets;
+    for (U32 i = 0; i < triangleCount * 3; ++i) {
+      adjacency[offsets[indices[i]]++] = i / 3;
+    }
+  }
+
+  // one past the meshlet every vertex was last added to and every triangle
+  // was last a candidate of
+  List<U32> vertexMeshlets(vertexCount, 0);
+  List<U32> candidateMeshlets(triangleCount, 0);
+  List<U8> isTriangleUsed(triangleCount, 0);
+  List<U32> candidates;
+  List<math::Vec3> normals;
+  normals.reserve(maxTriangles);
+
+  auto computeBounds = [&](Meshlet& meshlet) {
+    const auto triangles = &meshletIndices[meshlet.indexStart];
+    auto minimum = getPosition(triangles[0]);
+    auto maximum = minimum;
+    for (U32 i = 0; i < meshlet.triangleCount * 3; ++i) {
+      const auto position = getPosition(triangles[i]);
+      for (U32 j = 0; j < 3; ++j) {
+        minimum[j] = std::min(minimum[j], position[j]);
+        maximum[j] = std::max(maximum[j], position[j]);
+      }
+    }
+    meshlet.center = (minimum + maximum) * 0.5f;
+    for (U32 i = 0; i < meshlet.triangleCount * 3; ++i) {
+      meshlet.radius =
+          std::max(meshlet.radius,
+                   (getPosition(triangles[i]) - meshlet.center).Length());
+    }
+
+    // Degenerate triangles have no pixels and no say in the cone. A meshlet
+    // only faces away once the view is within 90 degrees minus the spread of
+    // the normals from the axis.
+    normals.clear();
+    auto axis = math::Vec3(0.0f, 0.0f, 0.0f);
+    for (U32 i = 0; i < meshlet.triangleCount; ++i) {
+      const auto p0 = getPosition(triangles[i * 3]);
+      const auto normal = (getPosition(triangles[i * 3 + 1]) - p0)
+                              .Cross(getPosition(triangles[i * 3 + 2]) - p0);
+      const auto length = normal.Length();
+      if (length > 0.0f) {
+        normals.push_back(normal / length);
+        axis += normals.back();
+      }
+    }
+
+    const auto axisLength = axis.Length();
+    if (normals.empty() || axisLength == 0.0f) {
+      return;
+    }
+    axis /= axisLength;
+
+    auto minimumDot = 1.0f;
+    for (const auto& normal : normals) {
+      minimumDot = std::min(minimumDot, normal.Dot(axis));
+    }
+    // too wide to ever cull, the test would only cost time
+    if (minimumDot <= 0.1f) {
+      return;
+    }
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+  };
+
+  // the vertices of the triangle the meshlet does not have yet
+  auto countNewVertices = [&](U32 triangle, U32 tag) {
+    const auto corners = &indices[triangle * 3];
+    U32 count = 0;
+    for (U32 j = 0; j < 3; ++j) {
+      const Bool isRepeated = (j > 0 && corners[j] == corners[0]) ||
+                              (j > 1 && corners[j] == corners[1]);
+      count += vertexMeshlets[corners[j]] != tag && !isRepeated ? 1 : 0;
+    }
+    return count;
+  };
+
+  Meshlet meshlet;
+  auto centroid = math::Vec3(0.0f, 0.0f, 0.0f);
+  auto addTriangle = [&](U32 triangle, U32 tag) {
+    isTriangleUsed[triangle] = 1;
+    for (U32 j = 0; j < 3; ++j) {
+      const auto index = indices[triangle * 3 + j];
+      meshletIndices.push_back(index);
+      if (vertexMeshlets[index] != tag) {
+        vertexMeshlets[index] = tag;
+        centroid = (centroid * static_cast<F32>(meshlet.vertexCount) +
+                    getPosition(index)) /
+                   static_cast<F32>(meshlet.vertexCount + 1);
+        ++meshlet.vertexCount;
+      }
+
+      for (U32 k = adjacencyOffsets[index]; k < adjacencyOffsets[index + 1];
+           ++k) {
+        const auto neighbour = adjacency[k];
+        if (!isTriangleUsed[neighbour] && candidateMeshlets[neighbour] != tag) {
+          candidateMeshlets[neighbour] = tag;
+          candidates.push_back(neighbour);
+        }
+      }
+    }
+    ++meshlet.triangleCount;
+  };
+
+  // Meshlets grow from the first triangle left over to the neighbours adding
+  // the fewest vertices, then the closest ones, which keeps them compact and
+  // their normals close together. Without neighbours left they take the next
+  // triangles of the index buffer.
+  U32 nextTriangle = 0;
+  while (true) {
+    while (nextTriangle < triangleCount && isTriangleUsed[nextTriangle]) {
+      ++nextTriangle;
+    }
+    if (nextTriangle == triangleCount) {
+      break;
+    }
+
+    const auto tag = static_cast<U32>(meshlets.size() + 1);
+    meshlet = Meshlet();
+    meshlet.indexStart = static_cast<U32>(meshletIndices.size());
+    centroid = math::Vec3(0.0f, 0.0f, 0.0f);
+    candidates.clear();
+    addTriangle(nextTriangle, tag);
+
+    while (meshlet.triangleCount < maxTriangles) {
+      U32 best = ~0u;
+      U32 bestNewVertices = 4;
+      F32 bestDistance = std::numeric_limits<F32>::max();
+      for (U32 i = 0; i < candidates.size();) {
+        const auto triangle = candidates[i];
+        if (isTriangleUsed[triangle]) {
+          candidates[i] = candidates.back();
+          candidates.pop_back();
+          continue;
+        }
+
+        const auto newVertices = countNewVertices(triangle, tag);
+        const auto distance =
+            (getPosition(indices[triangle * 3]) - centroid).LengthSquared();
+        if (newVertices < bestNewVertices ||
+            (newVertices == bestNewVertices && distance < bestDistance)) {
+          best = triangle;
+          bestNewVertices = newVertices;
+          bestDistance = distance;
+        }
+        ++i;
+      }
+
+      if (best == ~0u) {
+        while (nextTriangle < triangleCount && isTriangleUsed[nextTriangle]) {
+          ++nextTriangle;
+        }
+        if (nextTriangle == triangleCount) {
+          break;
+        }
+        best = nextTriangle;
+        bestNewVertices = countNewVertices(best, tag);
+      }
+
+      if (meshlet.vertexCount + bestNewVertices > maxVertices) {
+        break;
+      }
+      addTriangle(best, tag);
+    }
+
+    computeBounds(meshlet);
+    meshlets.push_back(meshlet);
+  }
+
+  return meshlets;
+}
+
+}  // namespace xlux
\ No newline at end of file
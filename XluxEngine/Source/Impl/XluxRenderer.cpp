@@ -7,29 +7,69 @@
 #include "Impl/Shader.hpp"
 #include "Impl/Framebuffer.hpp"
 
+#include <numeric>
+
 namespace xlux {
 
-Renderer::Renderer() {
-  m_VertexShaderJob = CreateRawPtr<VertexShaderWorker>();
-  m_VertexShaderThreadPool = CreateRawPtr<
-      ThreadPool<k_VertexShaderWorkerCount, VertexShaderWorkerInput, U32>>(
-      m_VertexShaderJob);
+Renderer::Renderer(RawPtr<TaskScheduler> scheduler,
+                   RawPtr<LinearAllocatorPool> vertexToFragmentDataPool)
+    : m_Scheduler(scheduler),
+      m_VertexToFragmentDataPool(vertexToFragmentDataPool),
+      m_IdleStrategy(scheduler->GetIdleStrategy()) {
+  m_Queue = m_Scheduler->CreateQueue();
+  CreateFrame(0);
+}
+
+Renderer::~Renderer() {
+  // the older frame context first, the newer one may depend on it
+  for (U32 i = 1; i <= m_Frames.size(); ++i) {
+    const auto& frame = m_Frames[(m_FrameIndex + i) % m_Frames.size()];
+    if (frame) {
+      RecycleFrame(*frame);
+    }
+  }
+
+  // no worker touches the frame contexts anymore once the queue is idle
+  m_Scheduler->DestroyQueue(m_Queue);
+}
 
-  m_FragmentWorker = CreateScope<FragmentWorkerPoolType>();
-  m_FrameClearWorker = CreateScope<FrameClearWorkerPoolType>();
+void Renderer::CreateFrame(U32 index) {
+  const auto workerCount = m_Scheduler->GetThreadCount();
 
-  m_VertexToFragmentDataAllocator = CreateRawPtr<LinearAllocator>(
-      1024 * 1024 * 256, k_VertexShaderWorkerCount);  // 256MB x 8 = 2GB
+  m_Frames[index] = CreateScope<FrameContext>();
+  m_Frames[index]->renderer = this;
+  m_Frames[index]->ticket = m_NextTicket++;
+  m_Frames[index]->tileBinner = CreateScope<TileBinner>(workerCount);
 }
 
-Renderer::~Renderer() {
-  m_FragmentWorker.reset();
-  m_FrameClearWorker.reset();
+void Renderer::RecycleFrame(FrameContext& frame) {
+  frame.vertexFence.Wait(m_IdleStrategy);
+  frame.dispatchFence.Wait(m_IdleStrategy);
+  frame.fragmentFence.Wait(m_IdleStrategy);
 
-  delete m_VertexShaderThreadPool;
-  delete m_VertexShaderJob;
+  frame.drawInputs.clear();
+  if (frame.tileBinner->GetFramebuffer()) {
+    frame.tileBinner->Reset();
+  }
+  frame.pendingClear.reset();
+  if (frame.vertexToFragmentDataAllocator) {
+    m_VertexToFragmentDataPool->Release(frame.vertexToFragmentDataAllocator);
+    frame.vertexToFragmentDataAllocator = nullptr;
+  }
+  frame.ticket = m_NextTicket++;
+  m_DrawIndex = 0;
+}
+
+void Renderer::SetFramePipelining(Bool enabled) {
+#if defined(XLUX_VERY_STRICT_CHECKS)
+  if (m_IsInFrame) {
+    xlux::log::Error(
+        "Renderer::SetFramePipelining() called between BeginFrame() and "
+        "EndFrame()");
+  }
+#endif
 
-  delete m_VertexToFragmentDataAllocator;
+  m_IsFramePipelined = enabled;
 }
 
 void Renderer::BeginFrame() {
@@ -44,7 +84,7 @@ void Renderer::BeginFrame() {
   m_DetachedRendering = false;
 }
 
-void Renderer::EndFrame() {
+RenderTicket Renderer::EndFrame() {
 #if defined(XLUX_VERY_STRICT_CHECKS)
   if (!m_IsInFrame) {
     xlux::log::Error(
@@ -52,14 +92,23 @@ void Renderer::EndFrame() {
   }
 #endif
 
-  Flush();
+  RenderTicket ticket = 0;
+  if (m_IsFramePipelined) {
+    ticket = Submit();
+  } else {
+    // the last batch is the one submitted before when nothing was recorded
+    // since, Flush still waits for it
+    ticket = HasRecordedWork(GetFrame()) ? GetFrame().ticket
+                                         : GetFrame().ticket - 1;
+    Flush();
+  }
 
   m_ActiveViewport.reset();
   m_ActiveFramebuffer = nullptr;
   m_ActivePipeline = nullptr;
-  m_VertexToFragmentDataAllocator->Reset();
 
   m_IsInFrame = false;
+  return ticket;
 }
 
 void Renderer::Flush() {
@@ -69,10 +118,257 @@ void Renderer::Flush() {
         "Renderer::EndFrame() called without calling BeginFrame()");
   }
 #endif
-  m_VertexShaderThreadPool->WaitJobDone();
-  m_FrameClearWorker->WaitForIdle();
-  m_FragmentWorker->WaitForIdle();
-  m_VertexToFragmentDataAllocator->Reset();
+  FlushBins();
+}
+
+RenderTicket Renderer::Submit() {
+  auto& frame = GetFrame();
+  if (!HasRecordedWork(frame)) {
+    return frame.ticket - 1;
+  }
+
+  // The tiles are dispatched by a worker once the vertex work is done and
+  // the previous batch, which may write the same framebuffers, has finished.
+  // Nothing on this thread waits for either.
+  const Task dispatchDependency = {.fence = &frame.dispatchFence};
+  m_Queue->SubmitAfter(frame.vertexFence, dispatchDependency);
+  if (m_InFlightFence && !m_InFlightFence->IsSignaled()) {
+    m_Queue->SubmitAfter(*m_InFlightFence, dispatchDependency);
+  }
+  m_Queue->SubmitAfter(frame.dispatchFence,
+                       {.function = &Renderer::RunDispatchTask,
+                        .context = &frame,
+                        .fence = &frame.fragmentFence});
+  m_InFlightFence = &frame.fragmentFence;
+
+  // the other frame context was last submitted two batches ago
+  const auto ticket = frame.ticket;
+  m_FrameIndex = 1 - m_FrameIndex;
+  if (!m_Frames[m_FrameIndex]) {
+    CreateFrame(m_FrameIndex);
+  } else {
+    RecycleFrame(GetFrame());
+  }
+  m_DrawIndex = 0;
+
+  return ticket;
+}
+
+Bool Renderer::IsComplete(RenderTicket ticket) {
+  if (ticket >= GetFrame().ticket) {
+    return !HasRecordedWork(GetFrame());
+  }
+
+  // a frame context only moves on to a new ticket once its work is done
+  for (auto& frame : m_Frames) {
+    if (frame && frame->ticket == ticket) {
+      return frame->fragmentFence.IsSignaled();
+    }
+  }
+  return true;
+}
+
+void Renderer::Wait(RenderTicket ticket) {
+  if (ticket >= GetFrame().ticket) {
+    Submit();
+  }
+
+  for (auto& frame : m_Frames) {
+    if (frame && frame->ticket == ticket) {
+      frame->fragmentFence.Wait(m_IdleStrategy);
+    }
+  }
+}
+
+void Renderer::FlushBins() {
+  // a batch submitted without waiting is waited for even with nothing
+  // recorded since
+  auto& frame = GetFrame();
+  if (!HasRecordedWork(frame)) {
+    if (m_InFlightFence) {
+      m_InFlightFence->Wait(m_IdleStrategy);
+      m_InFlightFence = nullptr;
+    }
+    return;
+  }
+
+  frame.vertexFence.Wait(m_IdleStrategy);
+  if (m_InFlightFence) {
+    m_InFlightFence->Wait(m_IdleStrategy);
+    m_InFlightFence = nullptr;
+  }
+
+  // dispatched from here, so that the tiles go to their owners
+  DispatchTiles(frame, false, 0);
+  frame.fragmentFence.Wait(m_IdleStrategy);
+  RecycleFrame(frame);
+}
+
+void Renderer::RunDispatchTask(RawPtr<void> context, U64 argument,
+                               U32 threadID) {
+  (void)argument;
+
+  auto frame = reinterpret_cast<RawPtr<FrameContext>>(context);
+  frame->renderer->DispatchTiles(*frame, true, threadID);
+}
+
+void Renderer::DispatchTiles(FrameContext& frame, Bool isOnWorker,
+                             U32 threadID) {
+  auto framebuffer = frame.tileBinner->GetFramebuffer();
+  frame.tiles.clear();
+  if (framebuffer) {
+    framebuffer->ValidateHierarchicalDepth();
+    frame.tileBinner->GetPendingTiles(frame.tiles);
+  }
+
+  // The clear was recorded before the draws of the batch, every tile it
+  // covers clears itself before shading them. Whole framebuffer tiles are
+  // cleared, the tiles and the hierarchical depth are in rasterizer space
+  // which has y flipped.
+  std::set<U32> clearTiles;
+  Pair<U32, U32> clearStart = {0, 0};
+  Pair<U32, U32> clearEnd = {0, 0};
+  if (frame.pendingClear) {
+    const auto& input = frame.pendingClear->x;
+    const auto& viewport = frame.pendingClear->y;
+    framebuffer = input.framebuffer;
+
+    const auto tileSize = framebuffer->GetTileSize();
+    const auto width = static_cast<U32>(framebuffer->GetWidth());
+    const auto height = static_cast<U32>(framebuffer->GetHeight());
+    const auto endX = static_cast<U32>(viewport.x + viewport.width);
+    const auto endY = static_cast<U32>(viewport.y + viewport.height);
+    clearStart =
+        MakePair(static_cast<U32>(viewport.x) / tileSize.x * tileSize.x,
+                 static_cast<U32>(viewport.y) / tileSize.y * tileSize.y);
+    clearEnd = MakePair(
+        std::min((endX + tileSize.x - 1) / tileSize.x * tileSize.x, width),
+        std::min((endY + tileSize.y - 1) / tileSize.y * tileSize.y, height));
+    clearTiles = framebuffer->GetOverlappingTiles(
+        clearStart.x, height - clearEnd.y, clearEnd.x - clearStart.x,
+        clearEnd.y - clearStart.y);
+
+    if (input.shouldClearDepth && framebuffer->HasDepthAttachment()) {
+      framebuffer->ValidateHierarchicalDepth();
+      framebuffer->ClearHierarchicalDepth(clearStart.x, height - clearEnd.y,
+                                          clearEnd.x, height - clearStart.y,
+                                          FrameClearWorker::k_ClearDepth);
+    }
+  }
+
+  frame.fragmentInput = {
+      .slotId = 0,
+      .framebuffer = framebuffer,
+      .binner = frame.tileBinner->GetFramebuffer() ? frame.tileBinner.get()
+                                                   : nullptr,
+      .clear = frame.pendingClear ? &frame.pendingClear->x : nullptr,
+      .clearStart = clearStart,
+      .clearEnd = clearEnd,
+  };
+
+  frame.tileTasks.clear();
+  for (auto tileId : frame.tiles) {
+    const U64 clearBit = clearTiles.erase(tileId) > 0
+                             ? FragmentShaderWorkerInput::k_ClearTileBit
+                             : 0;
+    frame.tileTasks.push_back({.function = &FragmentShaderWorker::RunTask,
+                               .context = &frame.fragmentInput,
+                               .argument = tileId | clearBit,
+                               .fence = &frame.fragmentFence});
+  }
+  for (auto tileId : clearTiles) {
+    frame.tileTasks.push_back(
+        {.function = &FragmentShaderWorker::RunTask,
+         .context = &frame.fragmentInput,
+         .argument = tileId | FragmentShaderWorkerInput::k_ClearTileBit,
+         .fence = &frame.fragmentFence});
+  }
+
+  if (isOnWorker) {
+    m_Scheduler->Spawn(frame.tileTasks.data(),
+                       static_cast<U32>(frame.tileTasks.size()), threadID);
+  } else {
+    SubmitTileTasks(framebuffer, frame.tileTasks);
+  }
+}
+
+void Renderer::SubmitTileTasks(RawPtr<IFramebuffer> framebuffer,
+                               List<Task>& tasks) {
+  if (m_TileAffinity == TileAffinity_Dynamic) {
+    m_Queue->Submit(tasks.data(), static_cast<U32>(tasks.size()));
+    return;
+  }
+
+  // every owner gets all of its tiles in one go
+  UpdateTileOwners(framebuffer);
+  auto ownerOf = [&](const Task& task) {
+    return m_TileOwners[static_cast<U32>(task.argument)];
+  };
+  std::stable_sort(tasks.begin(), tasks.end(),
+                   [&](const Task& a, const Task& b) {
+                     return ownerOf(a) < ownerOf(b);
+                   });
+
+  for (Size start = 0; start < tasks.size();) {
+    const auto owner = ownerOf(tasks[start]);
+    Size end = start + 1;
+    while (end < tasks.size() && ownerOf(tasks[end]) == owner) {
+      ++end;
+    }
+
+    const auto count = static_cast<U32>(end - start);
+    if (m_AllowTileStealing) {
+      m_Queue->SubmitTo(&tasks[start], count, owner);
+    } else {
+      m_Queue->SubmitPinned(&tasks[start], count, owner);
+    }
+    start = end;
+  }
+}
+
+void Renderer::UpdateTileOwners(RawPtr<IFramebuffer> framebuffer) {
+  const auto tileCount = framebuffer->GetTileCount();
+  if (!m_TileOwners.empty() && m_TileOwnersTileCount.x == tileCount.x &&
+      m_TileOwnersTileCount.y == tileCount.y) {
+    return;
+  }
+
+  const auto workerCount = m_Scheduler->GetThreadCount();
+  const auto totalTileCount = tileCount.x * tileCount.y;
+  m_TileOwners.resize(totalTileCount);
+  m_TileOwnersTileCount = tileCount;
+
+  if (m_TileAffinity == TileAffinity_Interleaved) {
+    for (U32 tileId = 0; tileId < totalTileCount; ++tileId) {
+      m_TileOwners[tileId] = tileId % workerCount;
+    }
+    return;
+  }
+
+  // spreads the lower 16 bits of a value out to the even bits
+  auto spreadBits = [](U32 value) {
+    value &= 0x0000FFFF;
+    value = (value | (value << 8)) & 0x00FF00FF;
+    value = (value | (value << 4)) & 0x0F0F0F0F;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+    return value;
+  };
+  auto mortonCode = [&](U32 tileId) {
+    return spreadBits(tileId % tileCount.x) |
+           (spreadBits(tileId / tileCount.x) << 1);
+  };
+
+  List<U32> tilesInOrder(totalTileCount);
+  std::iota(tilesInOrder.begin(), tilesInOrder.end(), 0);
+  std::sort(tilesInOrder.begin(), tilesInOrder.end(),
+            [&](U32 a, U32 b) { return mortonCode(a) < mortonCode(b); });
+
+  // every worker owns a contiguous run of the curve
+  for (U32 i = 0; i < totalTileCount; ++i) {
+    m_TileOwners[tilesInOrder[i]] =
+        static_cast<U32>(static_cast<U64>(i) * workerCount / totalTileCount);
+  }
 }
 
 void Renderer::BindFramebuffer(RawPtr<IFramebuffer> fbo) {
@@ -83,6 +379,10 @@ void Renderer::BindFramebuffer(RawPtr<IFramebuffer> fbo) {
   }
 #endif
 
+  if (m_ActiveFramebuffer != fbo) {
+    Submit();
+  }
+
   m_ActiveFramebuffer = fbo;
 }
 
@@ -90,31 +390,37 @@ void Renderer::BindPipeline(RawPtr<Pipeline> pipeline) {
   m_ActivePipeline = pipeline;
 }
 
-void Renderer::Clear(Bool color, Bool depth) {
+RenderTicket Renderer::Clear(Bool color, Bool depth) {
 #if defined(XLUX_VERY_STRICT_CHECKS)
   if (!m_ActiveViewport.has_value()) {
     xlux::log::Error("Renderer::Clear() called without calling SetViewport()");
   }
 #endif
 
-  const auto startX = m_ActiveViewport->x;
-  const auto startY = m_ActiveViewport->y;
-  const auto endX = m_ActiveViewport->x + m_ActiveViewport->width;
-  const auto endY = m_ActiveViewport->y + m_ActiveViewport->height;
-
-  FrameClearWorkerInput input = {.slotId = 0,
-                                 .clearColor = m_ClearColor,
-                                 .framebuffer = m_ActiveFramebuffer,
-                                 .shouldClearColor = color,
-                                 .shouldClearDepth = depth};
+  // draws recorded so far must land before the clear, which goes first in
+  // the next batch
+  if (HasRecordedWork(GetFrame())) {
+    Submit();
+  }
 
-  auto tiles = m_ActiveFramebuffer->GetOverlappingTiles(
-      startX, startY, endX - startX, endY - startY);
-  for (auto tileId : tiles) {
-    input.slotId = tileId;
-    m_FrameClearWorker->AddJob(input);
+  auto& frame = GetFrame();
+  frame.pendingClear = MakePair(FrameClearWorkerInput{.slotId = 0,
+                                                      .clearColor =
+                                                          m_ClearColor,
+                                                      .framebuffer =
+                                                          m_ActiveFramebuffer,
+                                                      .shouldClearColor = color,
+                                                      .shouldClearDepth =
+                                                          depth},
+                                m_ActiveViewport.value());
+
+  // With frame pipelining the clear is only recorded, so that the vertex
+  // work of the draws after it does not wait for the previous frame.
+  const auto ticket = frame.ticket;
+  if (!m_DetachedRendering && !m_IsFramePipelined) {
+    FlushBins();
   }
-  m_FragmentWorker->WaitForIdle();
+  return ticket;
 }
 
 void Renderer::SetViewport(I32 x, I32 y, I32 width, I32 height) {
@@ -144,9 +450,9 @@ void Renderer::SetViewport(I32 x, I32 y, I32 width, I32 height) {
   m_ActiveViewport = Viewport{x, y, width, height};
 }
 
-void Renderer::DrawIndexed(RawPtr<Buffer> vertexBuffer,
-                           RawPtr<Buffer> indexBuffer, U32 indexCount,
-                           U32 startingVertex, U32 startingIndex) {
+RenderTicket Renderer::DrawIndexed(RawPtr<Buffer> vertexBuffer,
+                                   RawPtr<Buffer> indexBuffer, U32 indexCount,
+                                   U32 startingVertex, U32 startingIndex) {
 #if defined(XLUX_VERY_STRICT_CHECKS)
   if (!m_IsInFrame) {
     xlux::log::Error(
@@ -177,126 +483,208 @@ void Renderer::DrawIndexed(RawPtr<Buffer> vertexBuffer,
   }
 #endif
 
-  auto vertexShaderJob =
-      reinterpret_cast<RawPtr<VertexShaderWorker>>(m_VertexShaderJob);
-  vertexShaderJob->SetVertexToFragmentDataAllocator(
-      m_VertexToFragmentDataAllocator);
-
-  for (auto i = 0; i < static_cast<I32>(indexCount); i += 3) {
-    m_VertexShaderThreadPool->AddJob(
-        {.indexStart = i,
-         .userData = m_RendererUserData,
+  BeginDraw();
 
-         .startingVertex = startingVertex,
-         .startingIndex = startingIndex,
+  const auto ticket = GetFrame().ticket;
+  const Pair<U32, U32> indexRange(0u, indexCount);
+  SubmitVertexTasks(vertexBuffer, indexBuffer, &indexRange, 1, startingVertex,
+                    startingIndex);
 
-         .vertexBuffer = vertexBuffer,
-         .indexBuffer = indexBuffer,
-
-         .pipeline = m_ActivePipeline,
-         .framebuffer = m_ActiveFramebuffer,
+  if (!m_DetachedRendering) {
+    FlushBins();
+  }
+  return ticket;
+}
 
-         .rasterizer = std::bind(&Renderer::PassTriangleToFragmentShader, this,
-                                 std::placeholders::_1)});
+RenderTicket Renderer::DrawIndexed(const DrawBounds& bounds,
+                                   RawPtr<Buffer> vertexBuffer,
+                                   RawPtr<Buffer> indexBuffer, U32 indexCount,
+                                   U32 startingVertex, U32 startingIndex) {
+#if defined(XLUX_VERY_STRICT_CHECKS)
+  if (!m_ActivePipeline) {
+    xlux::log::Error(
+        "Renderer::DrawIndexed() called without calling BindPipeline()");
   }
+#endif
 
-  if (!m_DetachedRendering) {
-    m_VertexShaderThreadPool->WaitJobDone();
-    m_FragmentWorker->WaitForIdle();
+  if (bounds.IsOutsideFrustum(GetCullingPlaneCount())) {
+    return GetFrame().ticket;
   }
+  return DrawIndexed(vertexBuffer, indexBuffer, indexCount, startingVertex,
+                     startingIndex);
+}
+
+RenderTicket Renderer::DrawIndexedOrdered(RawPtr<Buffer> vertexBuffer,
+                                          RawPtr<Buffer> indexBuffer,
+                                          U32 indexCount, U32 startingVertex,
+                                          U32 startingIndex) {
+  return DrawIndexed(vertexBuffer, indexBuffer, indexCount, startingVertex,
+                     startingIndex);
 }
 
-void Renderer::DrawIndexedOrdered(RawPtr<Buffer> vertexBuffer,
-                                  RawPtr<Buffer> indexBuffer, U32 indexCount,
-                                  U32 startingVertex, U32 startingIndex) {
+RenderTicket Renderer::DrawMeshlets(RawPtr<Buffer> vertexBuffer,
+                                    RawPtr<Buffer> indexBuffer,
+                                    const Meshlet* meshlets, U32 meshletCount,
+                                    const math::Mat4x4& objectToClip,
+                                    const math::Vec3& cameraPosition,
+                                    U32 startingVertex, U32 startingIndex) {
 #if defined(XLUX_VERY_STRICT_CHECKS)
   if (!m_IsInFrame) {
     xlux::log::Error(
-        "Renderer::DrawIndexed() called without calling BeginFrame()");
+        "Renderer::DrawMeshlets() called without calling BeginFrame()");
   }
 
   if (!m_ActiveFramebuffer) {
     xlux::log::Error(
-        "Renderer::DrawIndexed() called without calling BindFramebuffer()");
+        "Renderer::DrawMeshlets() called without calling BindFramebuffer()");
   }
 
   if (!m_ActivePipeline) {
     xlux::log::Error(
-        "Renderer::DrawIndexed() called without calling BindPipeline()");
+        "Renderer::DrawMeshlets() called without calling BindPipeline()");
   }
 
   if (!m_ActiveViewport.has_value()) {
     xlux::log::Error(
-        "Renderer::DrawIndexed() called without calling SetViewport()");
+        "Renderer::DrawMeshlets() called without calling SetViewport()");
   }
+#endif
 
-  if (indexCount == 0) {
-    xlux::log::Error("Renderer::DrawIndexed() called with 0 index count");
+  const auto& createInfo = m_ActivePipeline->m_CreateInfo;
+  const auto frustum = math::Frustum::FromMatrix(objectToClip);
+  const auto planeCount = GetCullingPlaneCount();
+
+  // meshlets next to each other in the index buffer are shaded as one range
+  m_IndexRanges.clear();
+  for (U32 i = 0; i < meshletCount; ++i) {
+    const auto& meshlet = meshlets[i];
+    if (frustum.IsSphereOutside(meshlet.center, meshlet.radius, planeCount) ||
+        (createInfo.enableBackfaceCulling &&
+         meshlet.IsFacingAway(cameraPosition))) {
+      continue;
+    }
+
+    const auto indexStart = meshlet.indexStart;
+    const auto indexEnd = meshlet.indexStart + meshlet.triangleCount * 3;
+    if (!m_IndexRanges.empty() && m_IndexRanges.back().y == indexStart) {
+      m_IndexRanges.back().y = indexEnd;
+    } else {
+      m_IndexRanges.push_back(Pair<U32, U32>(indexStart, indexEnd));
+    }
   }
 
-  if (indexCount % 3 != 0) {
-    xlux::log::Error("Renderer::DrawIndexed() called with invalid index count");
+  if (m_IndexRanges.empty()) {
+    return GetFrame().ticket;
   }
-#endif
-
-  auto vertexShaderJob =
-      reinterpret_cast<RawPtr<VertexShaderWorker>>(m_VertexShaderJob);
-
-  vertexShaderJob->SetVertexToFragmentDataAllocator(
-      m_VertexToFragmentDataAllocator);
 
-  for (auto i = 0; i < static_cast<I32>(indexCount); i += 3) {
-    m_VertexShaderThreadPool->AddJobTo(
-        {.indexStart = i,
-         .userData = m_RendererUserData,
+  BeginDraw();
 
-         .startingVertex = startingVertex,
-         .startingIndex = startingIndex,
-
-         .vertexBuffer = vertexBuffer,
-         .indexBuffer = indexBuffer,
-
-         .pipeline = m_ActivePipeline,
-         .framebuffer = m_ActiveFramebuffer,
-
-         .rasterizer = std::bind(&Renderer::PassTriangleToFragmentShader, this,
-                                 std::placeholders::_1)},
-        0);
-  }
+  const auto ticket = GetFrame().ticket;
+  SubmitVertexTasks(vertexBuffer, indexBuffer, m_IndexRanges.data(),
+                    static_cast<U32>(m_IndexRanges.size()), startingVertex,
+                    startingIndex);
 
   if (!m_DetachedRendering) {
-    m_VertexShaderThreadPool->WaitJobDone();
-    m_FragmentWorker->WaitForIdle();
+    FlushBins();
   }
+  return ticket;
 }
 
-Bool Renderer::PassTriangleToFragmentShader(ShaderTriangleRef triangle) {
-  auto boundingBox = triangle.GetBoundingBox();  // (xmin, ymin, xmax, ymax)
+U32 Renderer::GetCullingPlaneCount() const {
+  return m_ActivePipeline->m_CreateInfo.enableClipping
+             ? math::Frustum::Plane_Count
+             : math::Frustum::Plane_Near;
+}
 
-  FragmentShaderWorkerInput input = {
-      .triangle = triangle,
-      .slotId = 0,
-      .pipeline = m_ActivePipeline,
-      .framebuffer = m_ActiveFramebuffer,
-  };
+void Renderer::BeginDraw() {
+  if (GetFrame().tileBinner->GetFramebuffer() != m_ActiveFramebuffer) {
+    if (GetFrame().tileBinner->GetFramebuffer()) {
+      Submit();
+    }
+    GetFrame().tileBinner->Begin(m_ActiveFramebuffer);
+  }
+}
 
-  auto minX = static_cast<I32>(std::floor(boundingBox[0]));
-  auto minY = static_cast<I32>(std::floor(boundingBox[1]));
-  auto maxX = static_cast<I32>(std::ceil(boundingBox[2]));
-  auto maxY = static_cast<I32>(std::ceil(boundingBox[3]));
+void Renderer::SubmitVertexTasks(RawPtr<Buffer> vertexBuffer,
+                                 RawPtr<Buffer> indexBuffer,
+                                 const Pair<U32, U32>* indexRanges,
+                                 U32 rangeCount, U32 startingVertex,
+                                 U32 startingIndex) {
+  U32 triangleCount = 0;
+  for (U32 i = 0; i < rangeCount; ++i) {
+    triangleCount += (indexRanges[i].y - indexRanges[i].x) / 3;
+  }
+  const auto taskCount = m_Scheduler->GetThreadCount() * k_VertexTasksPerWorker;
+  const auto trianglesPerTask =
+      std::clamp(triangleCount / taskCount, k_MinTrianglesPerTask,
+                 k_MaxTrianglesPerTask);
+
+  // the draw input lives until the next flush, every task of the draw only
+  // carries the first index of its range
+  auto& frame = GetFrame();
+  if (!frame.vertexToFragmentDataAllocator) {
+    frame.vertexToFragmentDataAllocator =
+        m_VertexToFragmentDataPool->Acquire();
+  }
+  frame.drawInputs.push_back(CreateScope<VertexShaderWorkerInput>(
+      VertexShaderWorkerInput{
+          .drawIndex = m_DrawIndex++,
+          .userData = m_RendererUserData,
+
+          .startingVertex = startingVertex,
+          .startingIndex = startingIndex,
+
+          .vertexBuffer = vertexBuffer,
+          .indexBuffer = indexBuffer,
+
+          .pipeline = m_ActivePipeline,
+          .framebuffer = m_ActiveFramebuffer,
+          .vertexToFragmentDataAllocator = frame.vertexToFragmentDataAllocator,
+
+          .rasterizer = &Renderer::BinTriangle,
+          .rasterizerContext = &frame,
+      }));
+  const auto drawInput = frame.drawInputs.back().get();
+
+  // the ranges are cut in tasks of their own, whole triangles only
+  const auto indicesPerTask = trianglesPerTask * 3;
+  m_Tasks.clear();
+  for (U32 i = 0; i < rangeCount; ++i) {
+    const auto indexEnd =
+        indexRanges[i].x + (indexRanges[i].y - indexRanges[i].x) / 3 * 3;
+    for (auto indexStart = indexRanges[i].x; indexStart < indexEnd;
+         indexStart += indicesPerTask) {
+      m_Tasks.push_back(
+          {.function = &VertexShaderWorker::RunTask,
+           .context = drawInput,
+           .argument = VertexShaderWorker::GetTaskArgument(
+               indexStart, std::min(indexStart + indicesPerTask, indexEnd)),
+           .fence = &frame.vertexFence});
+    }
+  }
 
-  auto startX = static_cast<U32>(std::max(0, minX));
-  auto startY = static_cast<U32>(std::max(0, minY));
-  auto endX = static_cast<U32>(std::max(0, maxX));
-  auto endY = static_cast<U32>(std::max(0, maxY));
+  // the tiles put the triangles back in order, so any worker may shade them
+  m_Queue->Submit(m_Tasks.data(), static_cast<U32>(m_Tasks.size()));
+}
 
-  auto tiles = m_ActiveFramebuffer->GetOverlappingTiles(
-      startX, startY, endX > startX ? endX - startX : 0,
-      endY > startY ? endY - startY : 0);
-  for (auto tileId : tiles) {
-    input.slotId = tileId;
-    m_FragmentWorker->AddJob(input);
+Bool Renderer::BinTriangle(RawPtr<void> context, RawPtr<Pipeline> pipeline,
+                           ShaderTriangleRef triangle, U64 sequence,
+                           Size threadID) {
+  auto frame = reinterpret_cast<RawPtr<FrameContext>>(context);
+
+  // the triangle is referenced from every bin it overlaps, so it is stored
+  // once next to its vertex data
+  auto binned = reinterpret_cast<RawPtr<BinnedTriangle>>(
+      frame->vertexToFragmentDataAllocator->Allocate(sizeof(BinnedTriangle),
+                                                     threadID));
+  if (!binned) {
+    return false;
   }
+  new (binned) BinnedTriangle{.triangle = triangle,
+                              .pipeline = pipeline,
+                              .sequence = sequence};
+
+  frame->tileBinner->Bin(binned, threadID);
 
   return false;
 }
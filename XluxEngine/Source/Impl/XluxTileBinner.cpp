@@ -0,0 +1,95 @@
+#include "Core/Logger.hpp"
+#include "Impl/TileBinner.hpp"
+#include "Impl/Framebuffer.hpp"
+
+namespace xlux {
+
+TileBinner::TileBinner(U32 producerCount) : m_ProducerCount(producerCount) {
+  if (producerCount > k_MaxProducerCount) {
+    xlux::log::Error("TileBinner: too many producers ({} > {})", producerCount,
+                     k_MaxProducerCount);
+  }
+
+  m_TouchedTiles.resize(producerCount);
+}
+
+void TileBinner::Begin(RawPtr<IFramebuffer> framebuffer) {
+  m_Framebuffer = framebuffer;
+  m_TileSize = framebuffer->GetTileSize();
+  m_TileCount = framebuffer->GetTileCount();
+
+  const auto tileCount = m_TileCount.x * m_TileCount.y;
+  if (tileCount > m_TileCapacity) {
+    // the bins are empty here and keep their capacity between frames, so
+    // this only reallocates when a larger framebuffer is bound
+    m_Bins.clear();
+    m_Bins.resize(m_ProducerCount * tileCount);
+    m_TileCapacity = tileCount;
+    m_IsTilePending.resize(tileCount, 0);
+  }
+}
+
+void TileBinner::Bin(RawPtr<const BinnedTriangle> binned, Size producerID) {
+  const auto boundingBox =
+      binned->triangle.GetBoundingBox();  // (xmin, ymin, xmax, ymax)
+
+  const auto width = static_cast<I32>(m_Framebuffer->GetWidth());
+  const auto height = static_cast<I32>(m_Framebuffer->GetHeight());
+
+  // clamped before the conversion, positions far out of the framebuffer (or
+  // not finite) do not fit into an I32
+  auto toPixel = [](F32 value, I32 size) {
+    return value > 0.0f ? static_cast<I32>(std::min(value, F32(size))) : 0;
+  };
+  const auto startX = toPixel(std::floor(boundingBox[0]), width);
+  const auto startY = toPixel(std::floor(boundingBox[1]), height);
+  const auto endX = toPixel(std::ceil(boundingBox[2]), width);
+  const auto endY = toPixel(std::ceil(boundingBox[3]), height);
+
+  if (endX <= startX || endY <= startY) return;
+
+  const auto startTileX = static_cast<U32>(startX) / m_TileSize.x;
+  const auto startTileY = static_cast<U32>(startY) / m_TileSize.y;
+  const auto endTileX =
+      std::min((static_cast<U32>(endX) + m_TileSize.x - 1) / m_TileSize.x,
+               m_TileCount.x);
+  const auto endTileY =
+      std::min((static_cast<U32>(endY) + m_TileSize.y - 1) / m_TileSize.y,
+               m_TileCount.y);
+
+  auto& touchedTiles = m_TouchedTiles[producerID];
+  for (U32 tileY = startTileY; tileY < endTileY; ++tileY) {
+    for (U32 tileX = startTileX; tileX < endTileX; ++tileX) {
+      const auto tileId = tileY * m_TileCount.x + tileX;
+      auto& bin = GetBin(static_cast<U32>(producerID), tileId);
+      if (bin.empty()) touchedTiles.push_back(tileId);
+      bin.push_back(binned);
+    }
+  }
+}
+
+void TileBinner::GetPendingTiles(List<U32>& tiles) {
+  tiles.clear();
+  for (const auto& touchedTiles : m_TouchedTiles) {
+    for (auto tileId : touchedTiles) {
+      if (!m_IsTilePending[tileId]) {
+        m_IsTilePending[tileId] = 1;
+        tiles.push_back(tileId);
+      }
+    }
+  }
+
+  for (auto tileId : tiles) m_IsTilePending[tileId] = 0;
+}
+
+void TileBinner::Reset() {
+  for (U32 producer = 0; producer < m_ProducerCount; ++producer) {
+    for (auto tileId : m_TouchedTiles[producer]) {
+      GetBin(producer, tileId).clear();
+    }
+    m_TouchedTiles[producer].clear();
+  }
+  m_Framebuffer = nullptr;
+}
+
+}  // namespace xlux
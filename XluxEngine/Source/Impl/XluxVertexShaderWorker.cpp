@@ -6,280 +6,509 @@
 #include "Impl/Shader.hpp"
 #include "Impl/Framebuffer.hpp"
 
+#include <bit>
+#include <new>
+
 namespace xlux {
+void VertexShaderWorker::RunTask(RawPtr<void> context, U64 argument,
+                                 U32 threadID) {
+  auto payload =
+      *reinterpret_cast<RawPtr<const VertexShaderWorkerInput>>(context);
+  payload.indexStart = static_cast<I32>(argument & 0xFFFFFFFF);
+  payload.indexEnd = static_cast<I32>(argument >> 32);
+
+  VertexShaderWorker worker;
+  U32 result = 0;
+  worker.Execute(payload, result, threadID);
+}
+
 Bool VertexShaderWorker::Execute(VertexShaderWorkerInput payload, U32& result,
                                  Size threadID) {
   (void)result;
 
-  const auto indexBufferPtr = payload.indexBuffer->GetDataPtrWithOffset(
-      payload.startingIndex * sizeof(U32));
-  const auto vertexBufferPtr = payload.vertexBuffer->GetDataPtrWithOffset(
-      payload.startingVertex * payload.pipeline->m_CreateInfo.vertexItemSize);
-
-  const U32 triangleIndex[3] = {((U32*)indexBufferPtr)[payload.indexStart + 0],
-                                ((U32*)indexBufferPtr)[payload.indexStart + 1],
-                                ((U32*)indexBufferPtr)[payload.indexStart + 2]};
-
-  void* vertexData[3] = {
-      &((U8*)vertexBufferPtr)[triangleIndex[0] *
-                              payload.pipeline->m_CreateInfo.vertexItemSize],
-      &((U8*)vertexBufferPtr)[triangleIndex[1] *
-                              payload.pipeline->m_CreateInfo.vertexItemSize],
-      &((U8*)vertexBufferPtr)[triangleIndex[2] *
-                              payload.pipeline->m_CreateInfo.vertexItemSize]};
-
-  auto seedTraingle = ShaderTriangleRef(
-      m_VertexToFragmentDataAllocator,
-      payload.pipeline->m_CreateInfo.vertexToFragmentDataSize, threadID);
-
-  // Vertex Shader Call
-  for (auto i = 0; i < 3; ++i) {
-    seedTraingle.GetBuiltInRef(i)->Reset();
-    seedTraingle.GetBuiltInRef(i)->VertexIndex =
-        ((I32)payload.startingIndex + payload.indexStart) * 3 + i;
-    seedTraingle.GetBuiltInRef(i)->UserData = payload.userData;
-    payload.pipeline->m_CreateInfo.vertexShader->Execute(
-        vertexData[i], seedTraingle.GetVertexData(i),
-        seedTraingle.GetBuiltInRef(i));
-    seedTraingle.GetBuiltInRef(i)->Position /=
-        seedTraingle.GetBuiltInRef(i)->Position[3];
+  const auto indices =
+      reinterpret_cast<const U32*>(payload.indexBuffer->GetDataPtrWithOffset(
+          payload.startingIndex * sizeof(U32)));
+  const auto vertices =
+      reinterpret_cast<U8*>(payload.vertexBuffer->GetDataPtrWithOffset(
+          payload.startingVertex *
+          payload.pipeline->m_CreateInfo.vertexItemSize));
+
+  // Direct mapped on the index, shared vertices of a mesh are mostly close in
+  // the index buffer. Kept by the worker, its entries only last for the task.
+  // Without entries every corner of every triangle is shaded.
+  const auto cacheSize = payload.pipeline->m_CreateInfo.vertexCacheSize;
+  thread_local List<CachedVertex> cache;
+  cache.assign(cacheSize > 0 ? std::bit_ceil(cacheSize) : 0, CachedVertex());
+
+  for (auto indexStart = payload.indexStart; indexStart < payload.indexEnd;
+       indexStart += k_TrianglesPerBatch * 3) {
+    const auto indexEnd = std::min<I32>(indexStart + k_TrianglesPerBatch * 3,
+                                        payload.indexEnd);
+    ShadeTriangles(payload, indices, vertices, indexStart, indexEnd, cache,
+                   threadID);
   }
 
-  // Backface Culling
-  if (payload.pipeline->m_CreateInfo.enableBackfaceCulling) {
-    if (!IsTriangleFacingCamera(seedTraingle.GetBuiltInRef(0)->Position,
-                                seedTraingle.GetBuiltInRef(1)->Position,
-                                seedTraingle.GetBuiltInRef(2)->Position)) {
-      return false;
-    }
+  return false;
+}
+
+void VertexShaderWorker::ShadeBatch(const VertexShaderWorkerInput& payload,
+                                    const VertexBatch& batch,
+                                    Bool positionsOnly) {
+  const auto& createInfo = payload.pipeline->m_CreateInfo;
+  const auto shader =
+      positionsOnly ? createInfo.positionShader : createInfo.vertexShader;
+  const auto shadeFunction = positionsOnly ? createInfo.positionShadeFunction
+                                           : createInfo.vertexShadeFunction;
+  if (shadeFunction) {
+    shadeFunction(shader, batch);
+  } else {
+    shader->ExecuteBatch(batch);
   }
+}
+
+void VertexShaderWorker::ShadeTriangles(const VertexShaderWorkerInput& payload,
+                                        const U32* indices, U8* vertices,
+                                        I32 indexStart, I32 indexEnd,
+                                        List<CachedVertex>& cache,
+                                        Size threadID) {
+  const auto& createInfo = payload.pipeline->m_CreateInfo;
+  const auto cacheMask = static_cast<U32>(cache.size() - 1);
+  const auto cornerCount = static_cast<U32>(indexEnd - indexStart);
+
+  // Every vertex the triangles refer to is copied into the batch once, as a
+  // later miss may take over its slot of the cache in the meantime.
+  CachedVertex records[k_MaxBatchSize];
+  U32 recordCount = 0;
+  U32 cornerRecords[k_MaxBatchSize];
+  U32 misses[k_MaxBatchSize];
+  U32 missCount = 0;
+
+  for (U32 i = 0; i < cornerCount; ++i) {
+    const auto index = indices[indexStart + i];
+    if (cache.empty()) {
+      records[recordCount].index = index;
+      misses[missCount++] = recordCount;
+      cornerRecords[i] = recordCount++;
+      continue;
+    }
 
-  // Clipping
-  // auto triangles = List<ShaderTriangleRef>{ seedTraingle };
-  ShaderTriangleRef trianglesBuffer[2][16];
-  auto triangleBufferIndex = 0;
-  auto triangles = trianglesBuffer[triangleBufferIndex];
-  triangles[0] = seedTraingle;
-  Size triangleCount = 1;
-
-  // The way the fragment shader has been implemented, this renderer
-  // doesnt really need to clip triangles as it can automatically
-  // discard fragments that are outside the viewport.
-  // However, clipping is still implemented for the sake of completeness.
-  if (payload.pipeline->m_CreateInfo.enableClipping) {
-    // normal, point on plane (these are the planes of the cube from {-1, -1,
-    // -1} to {1, 1, 1})
-    static const Array<math::Vec3, 6> clipPlanes = {
-        math::Vec3(1.0f, 0.0f, 0.0f),  math::Vec3(0.0f, 1.0f, 0.0f),
-        math::Vec3(0.0f, 0.0f, 1.0f),  math::Vec3(-1.0f, 0.0f, 0.0f),
-        math::Vec3(0.0f, -1.0f, 0.0f), math::Vec3(0.0f, 0.0f, -1.0f)};
-
-    for (const auto& plane : clipPlanes) {
-      // triangles = ClipTrianglesAgainstPlane(triangles, plane, plane,
-      // threadID);
-      triangleCount = ClipTrianglesAgainstPlane(
-          trianglesBuffer[triangleBufferIndex], triangleCount, plane, plane,
-          threadID, payload, trianglesBuffer[1 - triangleBufferIndex]);
-      triangleBufferIndex = 1 - triangleBufferIndex;
+    auto& entry = cache[index & cacheMask];
+    if (entry.index != index) {
+      // triangles shaded earlier still refer to the vertex of the slot, the
+      // new one gets storage of its own
+      entry = CachedVertex();
+      entry.index = index;
+      misses[missCount++] = recordCount;
+    }
+    if (entry.record == ~0u) {
+      entry.record = recordCount;
+      records[recordCount++] = entry;
     }
+    cornerRecords[i] = entry.record;
   }
 
-  triangles = trianglesBuffer[triangleBufferIndex];
-
-  // Rasterization
-  // if (m_Rasterizer) // this will be true if everything is ok so just skip the
-  // check for performance
-  {
-    // for (auto& triangle : triangles)
-    for (U32 ti = 0; ti < triangleCount; ++ti) {
-      auto& triangle = triangles[ti];
-      // Transform NDC to Screen space
-      for (U32 i = 0; i < 3; ++i) {
-        auto& position = triangle.GetBuiltInRef(i)->Position;
-        // position = position / position[3];
-        position = position * 0.5f + math::Vec4(0.5f);
-
-        position[0] = position[0] * payload.framebuffer->GetWidth();
-        position[1] = position[1] * payload.framebuffer->GetHeight();
-        position[3] = 1.0f;
+  // With a position shader the triangles are culled before the vertex shader
+  // runs for their vertices.
+  const Bool hasPositionShader = createInfo.positionShader != nullptr;
+  if (missCount > 0) {
+    ShadeRecords(payload, vertices, records, misses, missCount,
+                 hasPositionShader, threadID);
+  }
+
+  Bool isCulled[k_TrianglesPerBatch];
+  Bool isNeeded[k_MaxBatchSize] = {};
+  U32 pending[k_MaxBatchSize];
+  U32 pendingCount = 0;
+  for (U32 i = 0; i < cornerCount; i += 3) {
+    const RawPtr<const CachedVertex> corners[3] = {
+        &records[cornerRecords[i]], &records[cornerRecords[i + 1]],
+        &records[cornerRecords[i + 2]]};
+    isCulled[i / 3] = IsTriangleCulled(payload, corners);
+    if (isCulled[i / 3]) {
+      continue;
+    }
+
+    for (U32 j = 0; j < 3; ++j) {
+      const auto record = cornerRecords[i + j];
+      if (!records[record].vertex && !isNeeded[record]) {
+        isNeeded[record] = true;
+        pending[pendingCount++] = record;
       }
-      payload.rasterizer(triangle);
+    }
+  }
+
+  if (pendingCount > 0) {
+    ShadeRecords(payload, vertices, records, pending, pendingCount, false,
+                 threadID);
+  }
+
+  for (U32 i = 0; i < cornerCount; i += 3) {
+    if (isCulled[i / 3]) {
+      continue;
+    }
+
+    // dropped as well when the allocator had no room for the outputs
+    const RawPtr<const CachedVertex> corners[3] = {
+        &records[cornerRecords[i]], &records[cornerRecords[i + 1]],
+        &records[cornerRecords[i + 2]]};
+    if (corners[0]->vertex && corners[1]->vertex && corners[2]->vertex) {
+      RasterizeTriangle(payload, corners, indexStart + i, threadID);
+    }
+  }
+
+  // unless a later miss took over the slot
+  for (U32 i = 0; i < recordCount && !cache.empty(); ++i) {
+    auto& entry = cache[records[i].index & cacheMask];
+    if (entry.record == i) {
+      entry = records[i];
+      entry.record = ~0u;
+    }
+  }
+}
+
+void VertexShaderWorker::ShadeRecords(const VertexShaderWorkerInput& payload,
+                                      U8* vertices, CachedVertex* records,
+                                      const U32* recordIndices, U32 count,
+                                      Bool positionsOnly, Size threadID) {
+  const auto& createInfo = payload.pipeline->m_CreateInfo;
+  const auto vertexDataSize = createInfo.vertexToFragmentDataSize;
+
+  void* vertexData[k_MaxBatchSize];
+  U32 vertexIndices[k_MaxBatchSize];
+  math::Vec4 positions[k_MaxBatchSize];
+  U32 positionCount = 0;
+  for (U32 i = 0; i < count; ++i) {
+    const auto& record = records[recordIndices[i]];
+    vertexData[i] = &vertices[record.index * createInfo.vertexItemSize];
+    vertexIndices[i] = static_cast<U32>(payload.startingVertex + record.index);
+    positions[i] = math::Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    positionCount += record.builtIn ? 0 : 1;
+  }
+
+  VertexBatch batch;
+  batch.count = count;
+  batch.inputs = vertexData;
+  batch.positions = positions;
+  batch.vertexIndices = vertexIndices;
+  batch.userData = payload.userData;
+  thread_local List<F32> outputStreams;
+  if (!positionsOnly) {
+    batch.outputSize = vertexDataSize;
+    batch.outputStreamStride = count;
+    outputStreams.resize(batch.GetOutputStreamCount() * count);
+    batch.outputs = outputStreams.data();
+  }
+  ShadeBatch(payload, batch, positionsOnly);
+
+  // The rest of the pipeline reads the outputs a vertex at a time, they are
+  // transposed into the vertex to fragment data. Vertices left without them
+  // or without a position once the allocator is full drop their triangles.
+  RawPtr<U8> outputs = nullptr;
+  if (!positionsOnly) {
+    outputs = payload.vertexToFragmentDataAllocator->Allocate(
+        vertexDataSize * count, threadID);
+    for (U32 i = 0; outputs && i < count; ++i) {
+      batch.LoadOutput(i, outputs + i * vertexDataSize);
+    }
+  }
+
+  const auto builtIns =
+      positionCount > 0
+          ? reinterpret_cast<RawPtr<ShaderBuiltIn>>(
+                payload.vertexToFragmentDataAllocator->Allocate(
+                    sizeof(ShaderBuiltIn) * positionCount, threadID))
+          : nullptr;
+  positionCount = 0;
+
+  const auto guardBand = GetGuardBand(payload);
+  for (U32 i = 0; i < count; ++i) {
+    auto& record = records[recordIndices[i]];
+    if (outputs) {
+      record.vertex = outputs + i * vertexDataSize;
+    }
+    if (record.builtIn || !builtIns) {
+      continue;
+    }
+
+    record.clipPosition = positions[i];
+    record.outcode = GetOutcode(positions[i], guardBand);
+    record.builtIn = new (&builtIns[positionCount++]) ShaderBuiltIn();
+    record.builtIn->VertexIndex = vertexIndices[i];
+    record.builtIn->UserData = payload.userData;
+    record.builtIn->Position = positions[i] / positions[i][3];
+    MapToScreen(record.builtIn->Position, payload);
+  }
+}
+
+Bool VertexShaderWorker::IsTriangleCulled(
+    const VertexShaderWorkerInput& payload,
+    const RawPtr<const CachedVertex>* corners) {
+  const auto& createInfo = payload.pipeline->m_CreateInfo;
+  const auto outcodes =
+      corners[0]->outcode | corners[1]->outcode | corners[2]->outcode;
+
+  // dropped, the allocator had no room left for one of the positions
+  if (!corners[0]->builtIn || !corners[1]->builtIn || !corners[2]->builtIn) {
+    return true;
+  }
+
+  // Outside of the same side of the screen nothing of it is drawn, nor is
+  // anything in front of the near or behind the far plane once clipped.
+  const U32 planes =
+      createInfo.enableClipping ? k_ScreenPlanes | k_DepthPlanes
+                                : k_ScreenPlanes;
+  if (corners[0]->outcode & corners[1]->outcode & corners[2]->outcode &
+      planes) {
+    return true;
+  }
+
+  // Behind the camera the perspective divide mirrors positions, such
+  // triangles are tested once they are clipped.
+  if (createInfo.enableBackfaceCulling &&
+      corners[0]->clipPosition[3] > 0.0f &&
+      corners[1]->clipPosition[3] > 0.0f &&
+      corners[2]->clipPosition[3] > 0.0f) {
+    if (!IsTriangleFacingCamera(
+            corners[0]->clipPosition / corners[0]->clipPosition[3],
+            corners[1]->clipPosition / corners[1]->clipPosition[3],
+            corners[2]->clipPosition / corners[2]->clipPosition[3])) {
+      return true;
+    }
+  }
+
+  // The rasterizer finds no pixels in it either, the area is exact on the
+  // snapped positions. Clipped triangles are left to the clipper, their
+  // vertices are snapped anew.
+  if (!createInfo.enableClipping || !(outcodes & k_ClippedPlanes)) {
+    // snapped like the rasterizer does, triangles reaching out of the fixed
+    // point range are left to it
+    I64 xs[3], ys[3];
+    Bool isInRange = true;
+    for (U32 i = 0; i < 3 && isInRange; ++i) {
+      isInRange = ToFixed(corners[i]->builtIn->Position[0], xs[i]) &&
+                  ToFixed(corners[i]->builtIn->Position[1], ys[i]);
+    }
+    if (isInRange && (xs[1] - xs[0]) * (ys[2] - ys[0]) ==
+                         (xs[2] - xs[0]) * (ys[1] - ys[0])) {
+      return true;
     }
   }
 
   return false;
 }
 
-Size VertexShaderWorker::ClipTrianglesAgainstPlane(
-    const ShaderTriangleRef* triangles, Size tianglesCountIn,
-    const math::Vec3& planeNormal, const math::Vec3& planePoint, Size threadID,
-    const VertexShaderWorkerInput& payload, ShaderTriangleRef* result) {
-  Size tianglesCountOut = 0;
-  // for (const auto& triangle : triangles)
-  for (U32 i = 0; i < tianglesCountIn; ++i) {
-    tianglesCountOut =
-        ClipTriangleAgainstPlane(triangles[i], planeNormal, planePoint,
-                                 threadID, tianglesCountOut, payload, result);
+void VertexShaderWorker::RasterizeTriangle(
+    const VertexShaderWorkerInput& payload,
+    const RawPtr<const CachedVertex>* corners, I32 indexStart,
+    Size threadID) {
+  const auto& createInfo = payload.pipeline->m_CreateInfo;
+  const auto outcodes =
+      corners[0]->outcode | corners[1]->outcode | corners[2]->outcode;
+  if (createInfo.enableClipping && (outcodes & k_ClippedPlanes)) {
+    ClipAndRasterize(payload, corners, indexStart, threadID);
+    return;
   }
-  return tianglesCountOut;
+
+  // within the guard band the shared vertices are used as they are
+  const RawPtr<void> vertexData[3] = {corners[0]->vertex, corners[1]->vertex,
+                                      corners[2]->vertex};
+  const RawPtr<ShaderBuiltIn> builtIns[3] = {
+      corners[0]->builtIn, corners[1]->builtIn, corners[2]->builtIn};
+  const auto sequence = (static_cast<U64>(payload.drawIndex) << 40) |
+                        (static_cast<U64>(indexStart / 3) << 8);
+  payload.rasterizer(
+      payload.rasterizerContext, payload.pipeline,
+      ShaderTriangleRef(vertexData, builtIns,
+                        createInfo.vertexToFragmentDataSize),
+      sequence, threadID);
 }
 
-Size VertexShaderWorker::ClipTriangleAgainstPlane(
-    const ShaderTriangleRef& triangle, const math::Vec3& planeNormal,
-    const math::Vec3& planePoint, Size threadID, Size tianglesCount,
-    const VertexShaderWorkerInput& payload, ShaderTriangleRef* result) {
-  // auto result = List<ShaderTriangleRef>();
-  auto intepolator = payload.pipeline->m_CreateInfo.interpolator;
-
-  Array<Pair<math::Vec4, U32>, 3> insidePoints;
-  Array<Pair<math::Vec4, U32>, 3> outsidePoints;
-  auto insidePointsCount = 0;
-  auto outsidePointsCount = 0;
-
-  auto distance = [&](const math::Vec3& point) {
-    return planeNormal.Dot(point - planePoint);
-  };
-
-  auto pushInsidePoint = [&](const math::Vec4& point, U32 index) {
-    insidePoints[insidePointsCount++] = {point, index};
-  };
-
-  auto pushOutsidePoint = [&](const math::Vec4& point, U32 index) {
-    outsidePoints[outsidePointsCount++] = {point, index};
-  };
-
-  auto pushPoint = [&](const math::Vec4& point, U32 index) {
-    if (distance(point) <= 0.0f)
-      pushInsidePoint(point, index);
-    else
-      pushOutsidePoint(point, index);
-  };
-
-  pushPoint(triangle.GetBuiltInRef(0)->Position, 0);
-  pushPoint(triangle.GetBuiltInRef(1)->Position, 1);
-  pushPoint(triangle.GetBuiltInRef(2)->Position, 2);
-
-  if (insidePointsCount == 3) {
-    // result.push_back(triangle);
-    result[tianglesCount++] = triangle;
-  } else if (insidePointsCount == 2) {
-    auto& insidePoint0 = insidePoints[0];
-    auto& insidePoint1 = insidePoints[1];
-    auto& outsidePoint0 = outsidePoints[0];
-
-    auto [interSectionPoint0, t0] =
-        PlaneIntersection(planeNormal, planePoint, math::Vec3(insidePoint0.x),
-                          math::Vec3(outsidePoint0.x));
-    auto [interSectionPoint1, t1] =
-        PlaneIntersection(planeNormal, planePoint, math::Vec3(insidePoint1.x),
-                          math::Vec3(outsidePoint0.x));
-
-    auto triangle0 = ShaderTriangleRef(
-        m_VertexToFragmentDataAllocator,
-        payload.pipeline->m_CreateInfo.vertexToFragmentDataSize, threadID);
-    auto triangle1 = ShaderTriangleRef(
-        m_VertexToFragmentDataAllocator,
-        payload.pipeline->m_CreateInfo.vertexToFragmentDataSize, threadID);
-
-    {
-      std::memcpy(triangle0.GetVertexData(0),
-                  triangle.GetVertexData(insidePoint0.y),
-                  payload.pipeline->m_CreateInfo.vertexToFragmentDataSize);
-      std::memcpy(triangle0.GetVertexData(1),
-                  triangle.GetVertexData(insidePoint1.y),
-                  payload.pipeline->m_CreateInfo.vertexToFragmentDataSize);
-
-      intepolator->Reset(triangle0.GetVertexData(2));
-      intepolator->ScaleAndAdd(triangle0.GetVertexData(2),
-                               triangle.GetVertexData(insidePoint1.y),
-                               1.0f - t1);
-      intepolator->ScaleAndAdd(triangle0.GetVertexData(2),
-                               triangle.GetVertexData(outsidePoint0.y), t1);
-
-      triangle0.GetBuiltInRef(0)->Position = insidePoint0.x;
-      triangle0.GetBuiltInRef(1)->Position = insidePoint1.x;
-      triangle0.GetBuiltInRef(2)->Position =
-          math::Vec4(interSectionPoint1, 1.0f);
-
-      // result.push_back(triangle0);
-      result[tianglesCount++] = triangle0;
+void VertexShaderWorker::ClipAndRasterize(
+    const VertexShaderWorkerInput& payload,
+    const RawPtr<const CachedVertex>* corners, I32 indexStart,
+    Size threadID) {
+  const auto& createInfo = payload.pipeline->m_CreateInfo;
+  const auto guardBand = GetGuardBand(payload);
+  const auto outcodes =
+      corners[0]->outcode | corners[1]->outcode | corners[2]->outcode;
+
+  // Sutherland-Hodgman, the polygon is clipped against one plane after the
+  // other, keeping the vertices inside of it and adding where its edges
+  // cross it
+  CachedVertex polygons[2][k_MaxClippedVertices];
+  U32 vertexCount = 3;
+  U32 current = 0;
+  for (U32 i = 0; i < 3; ++i) {
+    polygons[current][i] = *corners[i];
+  }
+
+  for (U32 bit = 0; bit < k_ClipPlaneCount; ++bit) {
+    const auto plane = static_cast<EClipPlane>(1u << bit);
+    if (!(plane & k_ClippedPlanes & outcodes)) {
+      continue;
+    }
+
+    const auto polygon = polygons[current];
+    const auto clipped = polygons[1 - current];
+    U32 clippedCount = 0;
+    for (U32 i = 0; i < vertexCount; ++i) {
+      const auto& from = polygon[i];
+      const auto& to = polygon[(i + 1) % vertexCount];
+      const auto fromDistance =
+          GetClipDistance(plane, from.clipPosition, guardBand);
+      const auto toDistance =
+          GetClipDistance(plane, to.clipPosition, guardBand);
+
+      if (fromDistance >= 0.0f) {
+        clipped[clippedCount++] = from;
+      }
+      if ((fromDistance >= 0.0f) != (toDistance >= 0.0f)) {
+        clipped[clippedCount] =
+            Intersect(payload, from, to,
+                      fromDistance / (fromDistance - toDistance), threadID);
+        if (!clipped[clippedCount++].vertex) {
+          return;
+        }
+      }
     }
 
-    {
-      std::memcpy(triangle1.GetVertexData(0),
-                  triangle.GetVertexData(insidePoint0.y),
-                  payload.pipeline->m_CreateInfo.vertexToFragmentDataSize);
-      std::memcpy(triangle1.GetVertexData(1), triangle0.GetVertexData(2),
-                  payload.pipeline->m_CreateInfo.vertexToFragmentDataSize);
-
-      intepolator->Reset(triangle1.GetVertexData(2));
-      intepolator->ScaleAndAdd(triangle1.GetVertexData(2),
-                               triangle.GetVertexData(insidePoint0.y),
-                               1.0f - t0);
-      intepolator->ScaleAndAdd(triangle1.GetVertexData(2),
-                               triangle.GetVertexData(outsidePoint0.y), t0);
-
-      triangle1.GetBuiltInRef(0)->Position = insidePoint0.x;
-      triangle1.GetBuiltInRef(1)->Position =
-          math::Vec4(interSectionPoint1, 1.0f);
-      triangle1.GetBuiltInRef(2)->Position =
-          math::Vec4(interSectionPoint0, 1.0f);
-
-      // result.push_back(triangle1);
-      result[tianglesCount++] = triangle1;
+    vertexCount = clippedCount;
+    current = 1 - current;
+    if (vertexCount < 3) {
+      return;
     }
-  } else if (insidePointsCount == 1) {
-    auto& insidePoint0 = insidePoints[0];
-    auto& outsidePoint0 = outsidePoints[0];
-    auto& outsidePoint1 = outsidePoints[1];
-
-    auto [interSectionPoint0, t0] =
-        PlaneIntersection(planeNormal, planePoint, math::Vec3(insidePoint0.x),
-                          math::Vec3(outsidePoint0.x));
-    auto [interSectionPoint1, t1] =
-        PlaneIntersection(planeNormal, planePoint, math::Vec3(insidePoint0.x),
-                          math::Vec3(outsidePoint1.x));
-
-    auto triangle0 = ShaderTriangleRef(
-        m_VertexToFragmentDataAllocator,
-        payload.pipeline->m_CreateInfo.vertexToFragmentDataSize, threadID);
-
-    std::memcpy(triangle0.GetVertexData(0),
-                triangle.GetVertexData(insidePoint0.y),
-                payload.pipeline->m_CreateInfo.vertexToFragmentDataSize);
-
-    intepolator->Reset(triangle0.GetVertexData(1));
-    intepolator->ScaleAndAdd(triangle0.GetVertexData(1),
-                             triangle.GetVertexData(insidePoint0.y), 1.0f - t0);
-    intepolator->ScaleAndAdd(triangle0.GetVertexData(1),
-                             triangle.GetVertexData(outsidePoint0.y), t0);
-
-    intepolator->Reset(triangle0.GetVertexData(2));
-    intepolator->ScaleAndAdd(triangle0.GetVertexData(2),
-                             triangle.GetVertexData(insidePoint0.y), 1.0f - t1);
-    intepolator->ScaleAndAdd(triangle0.GetVertexData(2),
-                             triangle.GetVertexData(outsidePoint1.y), t1);
-
-    triangle0.GetBuiltInRef(0)->Position = insidePoint0.x;
-    triangle0.GetBuiltInRef(1)->Position = math::Vec4(interSectionPoint0, 1.0f);
-    triangle0.GetBuiltInRef(2)->Position = math::Vec4(interSectionPoint1, 1.0f);
-
-    // result.push_back(triangle0);
-    result[tianglesCount++] = triangle0;
-  } else {
-    // all points are outside so no triangle is generated
   }
 
-  return tianglesCount;
+  const auto polygon = polygons[current];
+
+  // triangles crossing the camera plane are only tested now, the fan faces
+  // the way the polygon does
+  if (createInfo.enableBackfaceCulling &&
+      !(corners[0]->clipPosition[3] > 0.0f &&
+        corners[1]->clipPosition[3] > 0.0f &&
+        corners[2]->clipPosition[3] > 0.0f)) {
+    if (!IsTriangleFacingCamera(
+            polygon[0].clipPosition / polygon[0].clipPosition[3],
+            polygon[1].clipPosition / polygon[1].clipPosition[3],
+            polygon[2].clipPosition / polygon[2].clipPosition[3])) {
+      return;
+    }
+  }
+
+  // draw index, source triangle and triangle of the fan, so that sorting by
+  // sequence restores the submission order
+  const auto sequence = (static_cast<U64>(payload.drawIndex) << 40) |
+                        (static_cast<U64>(indexStart / 3) << 8);
+  for (U32 i = 1; i + 1 < vertexCount; ++i) {
+    const RawPtr<void> vertexData[3] = {polygon[0].vertex, polygon[i].vertex,
+                                        polygon[i + 1].vertex};
+    const RawPtr<ShaderBuiltIn> builtIns[3] = {
+        polygon[0].builtIn, polygon[i].builtIn, polygon[i + 1].builtIn};
+    payload.rasterizer(
+        payload.rasterizerContext, payload.pipeline,
+        ShaderTriangleRef(vertexData, builtIns,
+                          createInfo.vertexToFragmentDataSize),
+        sequence | (i - 1), threadID);
+  }
+}
+
+VertexShaderWorker::CachedVertex VertexShaderWorker::Intersect(
+    const VertexShaderWorkerInput& payload, const CachedVertex& from,
+    const CachedVertex& to, F32 t, Size threadID) {
+  const auto& createInfo = payload.pipeline->m_CreateInfo;
+  const auto interpolator = createInfo.interpolator;
+  const auto allocator = payload.vertexToFragmentDataAllocator;
+
+  CachedVertex result;
+  result.index = from.index;
+  result.clipPosition =
+      from.clipPosition + (to.clipPosition - from.clipPosition) * t;
+
+  // left without vertex data when the allocator is full, the triangle is
+  // dropped then
+  const auto vertex =
+      allocator->Allocate(createInfo.vertexToFragmentDataSize, threadID);
+  const auto builtIn = allocator->Allocate(sizeof(ShaderBuiltIn), threadID);
+  if (!vertex || !builtIn) {
+    return result;
+  }
+
+  // linear in clip space, which is perspective correct
+  result.vertex = vertex;
+  interpolator->Reset(result.vertex);
+  interpolator->ScaleAndAdd(result.vertex, from.vertex, 1.0f - t);
+  interpolator->ScaleAndAdd(result.vertex, to.vertex, t);
+
+  result.builtIn = new (builtIn) ShaderBuiltIn(*from.builtIn);
+  result.builtIn->Position = result.clipPosition / result.clipPosition[3];
+  MapToScreen(result.builtIn->Position, payload);
+  return result;
+}
+
+math::Vec2 VertexShaderWorker::GetGuardBand(
+    const VertexShaderWorkerInput& payload) {
+  // the screen spans 2 along x and y after the perspective divide
+  return math::Vec2(
+      1.0f + 2.0f * k_GuardBandSize / payload.framebuffer->GetWidth(),
+      1.0f + 2.0f * k_GuardBandSize / payload.framebuffer->GetHeight());
 }
 
-Pair<math::Vec3, F32> VertexShaderWorker::PlaneIntersection(
-    const math::Vec3& planeNormal, const math::Vec3& planePoint,
-    const math::Vec3& lineStart, const math::Vec3& lineEnd) {
-  auto planeDistance = planeNormal.Dot(planePoint - lineStart);
-  auto lineDistance = planeNormal.Dot(lineEnd - lineStart);
-  auto t = planeDistance / lineDistance;
-  return {lineStart + (lineEnd - lineStart) * t, t};
+F32 VertexShaderWorker::GetClipDistance(EClipPlane plane,
+                                        const math::Vec4& position,
+                                        const math::Vec2& guardBand) {
+  const auto w = position[3];
+  switch (plane) {
+    case ClipPlane_Right:
+      return w - position[0];
+    case ClipPlane_Left:
+      return w + position[0];
+    case ClipPlane_Top:
+      return w - position[1];
+    case ClipPlane_Bottom:
+      return w + position[1];
+    case ClipPlane_Far:
+      return w - position[2];
+    case ClipPlane_Near:
+      return w + position[2];
+    case ClipPlane_GuardRight:
+      return guardBand[0] * w - position[0];
+    case ClipPlane_GuardLeft:
+      return guardBand[0] * w + position[0];
+    case ClipPlane_GuardTop:
+      return guardBand[1] * w - position[1];
+    case ClipPlane_GuardBottom:
+      return guardBand[1] * w + position[1];
+  }
+  return 0.0f;
+}
+
+U32 VertexShaderWorker::GetOutcode(const math::Vec4& position,
+                                   const math::Vec2& guardBand) {
+  U32 outcode = 0;
+  for (U32 bit = 0; bit < k_ClipPlaneCount; ++bit) {
+    const auto plane = static_cast<EClipPlane>(1u << bit);
+    // written so that NaN lies outside of every plane
+    if (!(GetClipDistance(plane, position, guardBand) >= 0.0f)) {
+      outcode |= plane;
+    }
+  }
+  return outcode;
+}
+
+void VertexShaderWorker::MapToScreen(math::Vec4& position,
+                                     const VertexShaderWorkerInput& payload) {
+  position = position * 0.5f + math::Vec4(0.5f);
+
+  position[0] = position[0] * payload.framebuffer->GetWidth();
+  position[1] = position[1] * payload.framebuffer->GetHeight();
+  position[3] = 1.0f;
+
+  // snap to the sub pixel grid the rasterizer works on
+  position[0] = std::round(position[0] * k_SubPixelScale) /
+                static_cast<F32>(k_SubPixelScale);
+  position[1] = std::round(position[1] * k_SubPixelScale) /
+                static_cast<F32>(k_SubPixelScale);
 }
 
 Bool VertexShaderWorker::IsTriangleFacingCamera(const math::Vec4& v0,